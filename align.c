@@ -0,0 +1,112 @@
+/*
+
+	align.c
+	Latency compensation between channels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "align.h"
+
+
+align_t *align_new( unsigned int channels, unsigned int period )
+{
+	align_t *align;
+
+	if (channels == 0 || period > ALIGN_MAX_FRAMES) return NULL;
+
+	align = calloc( 1, sizeof(align_t) + sizeof(unsigned int) * channels );
+	if (align == NULL) return NULL;
+
+	align->channels = channels;
+	align->period = period;
+	align->line = calloc( (size_t) channels * ALIGN_MAX_FRAMES, sizeof(float) );
+	align->out = calloc( (size_t) channels * period, sizeof(float) );
+	if (align->line == NULL || align->out == NULL) {
+		align_free( align );
+		return NULL;
+	}
+
+	return align;
+}
+
+
+int align_set_latencies( align_t *align, const unsigned int *latency )
+{
+	unsigned int latest = 0, c;
+	int changed = 0;
+
+	for (c=0; c < align->channels; c++) {
+		if (latency[c] > latest) latest = latency[c];
+	}
+
+	// Anything longer than the delay lines is left as close as it can be
+	for (c=0; c < align->channels; c++) {
+		unsigned int delay = latest - latency[c];
+
+		if (delay > ALIGN_MAX_FRAMES - align->period) delay = ALIGN_MAX_FRAMES - align->period;
+		if (delay != align->delay[c]) {
+			align->delay[c] = delay;
+			changed = 1;
+		}
+	}
+
+	return changed;
+}
+
+
+const float *align_process( align_t *align, unsigned int channel, const float *in, unsigned int nframes )
+{
+	const unsigned int mask = ALIGN_MAX_FRAMES - 1;
+	const unsigned int delay = align->delay[channel];
+	float *line = align->line + (size_t) channel * ALIGN_MAX_FRAMES;
+	float *out = align->out + (size_t) channel * align->period;
+	unsigned int i;
+
+	// Keep the line going, so that a new delay has history behind it
+	for (i=0; i < nframes; i++) {
+		line[ (align->pos + i) & mask ] = in[i];
+	}
+
+	if (delay == 0 || nframes > align->period) return in;
+
+	for (i=0; i < nframes; i++) {
+		out[i] = line[ (align->pos + i - delay) & mask ];
+	}
+
+	return out;
+}
+
+
+void align_advance( align_t *align, unsigned int nframes )
+{
+	align->pos = (align->pos + nframes) & (ALIGN_MAX_FRAMES - 1);
+}
+
+
+void align_free( align_t *align )
+{
+	if (align == NULL) return;
+
+	free( align->line );
+	free( align->out );
+	free( align );
+}
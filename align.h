@@ -0,0 +1,63 @@
+/*
+
+	align.h
+	Latency compensation between channels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _ALIGN_H_
+#define _ALIGN_H_
+
+
+/* Longest delay a channel can be given (a power of two) */
+#define ALIGN_MAX_FRAMES	16384
+
+
+/*
+	Delays each channel by the difference between its capture latency
+	and the largest one, so that channels which come from different
+	clients line up to the sample. The delay lines and the buffers
+	handed back are allocated up front; the delays are set from the
+	main loop and read by the process callback.
+*/
+typedef struct {
+	unsigned int channels;
+	unsigned int period;
+
+	float *line;
+	float *out;
+	unsigned int pos;
+
+	/* One per channel, set outside the process callback */
+	volatile unsigned int delay[];
+} align_t;
+
+
+align_t *align_new( unsigned int channels, unsigned int period );
+
+/* Set the capture latency of each channel, returns non-zero if any delays changed */
+int align_set_latencies( align_t *align, const unsigned int *latency );
+
+/* Called from the JACK process callback for each channel in turn, then align_advance() */
+const float *align_process( align_t *align, unsigned int channel, const float *in, unsigned int nframes );
+void align_advance( align_t *align, unsigned int nframes );
+
+void align_free( align_t *align );
+
+
+#endif
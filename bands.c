@@ -0,0 +1,165 @@
+/*
+
+	bands.c
+	Octave and third-octave band level meter for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <complex.h>
+
+#include "bands.h"
+
+
+/* Nominal mid-band frequencies, third-octave from 25Hz */
+static const char *nominal[BANDS_MAX] = {
+	"25", "31.5", "40", "50", "63", "80", "100", "125", "160", "200",
+	"250", "315", "400", "500", "630", "800", "1k", "1k25", "1k6", "2k",
+	"2k5", "3k15", "4k", "5k", "6k3", "8k", "10k", "12k5", "16k", "20k"
+};
+
+
+/*
+	Design a Butterworth band-pass between f1 and f2 as BANDS_ORDER
+	sections. Each pole p of the low-pass prototype maps to the roots
+	of s^2 - p.B.s + w0^2, and each conjugate pair of those becomes
+	one section of B.s / (s^2 - 2.Re(q).s + |q|^2).
+*/
+static void design_bandpass( double f1, double f2, double samplerate, biquad_coeffs_t *sections )
+{
+	const double w1 = biquad_prewarp( f1, samplerate );
+	const double w2 = biquad_prewarp( f2, samplerate );
+	const double bw = w2 - w1;
+	const double w0sq = w1 * w2;
+	int n = 0, k;
+
+	for (k=0; k < (BANDS_ORDER+1)/2; k++) {
+		const double theta = M_PI * (2*k + BANDS_ORDER + 1) / (2.0 * BANDS_ORDER);
+		const double complex p = cexp( I * theta );
+		const double complex d = csqrt( p * p * bw * bw - 4.0 * w0sq );
+		const double complex q1 = (p * bw + d) / 2.0;
+		const double complex q2 = (p * bw - d) / 2.0;
+
+		if (fabs( cimag(p) ) < 1e-9) {
+			// Real prototype pole: q1 and q2 are already a conjugate pair
+			biquad_bilinear( 0.0, bw, 0.0, 1.0, -creal(q1 + q2), creal(q1 * q2), samplerate, &sections[n++] );
+		} else {
+			biquad_bilinear( 0.0, bw, 0.0, 1.0, -2.0 * creal(q1), creal(q1 * conj(q1)), samplerate, &sections[n++] );
+			biquad_bilinear( 0.0, bw, 0.0, 1.0, -2.0 * creal(q2), creal(q2 * conj(q2)), samplerate, &sections[n++] );
+		}
+	}
+}
+
+
+bands_t *bands_new( int per_octave, double samplerate )
+{
+	const double g = pow( 10.0, 0.3 );
+	bands_t *bands;
+	int i, step;
+
+	if (per_octave != 1 && per_octave != 3) return NULL;
+	step = 3 / per_octave;
+
+	bands = calloc( 1, sizeof(bands_t) );
+	if (bands == NULL) return NULL;
+
+	// Octave bands start at 31.5Hz, third-octaves at 25Hz
+	for (i = (per_octave == 1) ? 1 : 0; i < BANDS_MAX; i += step) {
+		const double fm = 1000.0 * pow( g, (i - 16) / 3.0 );
+		const double f2 = fm * pow( g, 1.0 / (2.0 * per_octave) );
+
+		// Leave out bands that the sample rate can't represent
+		if (f2 > 0.475 * samplerate) break;
+
+		bands->label[bands->count] = nominal[i];
+		bands->centre[bands->count] = fm;
+		bands->count++;
+	}
+
+	bands->bank = biquad_bank_new( bands->count, BANDS_ORDER );
+	if (bands->bank) {
+		bands->energy = calloc( bands->bank->lanes, sizeof(double) );
+	}
+	if (bands->energy == NULL) {
+		bands_free( bands );
+		return NULL;
+	}
+
+	for (i=0; i < bands->count; i++) {
+		const double fm = bands->centre[i];
+		const double half = pow( g, 1.0 / (2.0 * per_octave) );
+		biquad_coeffs_t sections[BANDS_ORDER];
+		int s;
+
+		design_bandpass( fm / half, fm * half, samplerate, sections );
+		for (s=0; s < BANDS_ORDER; s++) {
+			biquad_bank_set( bands->bank, i, s, &sections[s] );
+		}
+	}
+
+	return bands;
+}
+
+
+/* Called from the JACK process callback */
+void bands_process( bands_t *bands, const float *in, unsigned int nframes )
+{
+	biquad_bank_t *bank = bands->bank;
+	const unsigned int lanes = bank->lanes;
+	double *x = bank->x;
+	double *energy = bands->energy;
+	unsigned int i, l;
+
+	for (i=0; i < nframes; i++) {
+		const double s = in[i];
+
+		for (l=0; l < lanes; l++) x[l] = s;
+		biquad_bank_tick( bank );
+		for (l=0; l < lanes; l++) energy[l] += x[l] * x[l];
+	}
+
+	bands->frames += nframes;
+}
+
+
+/* Read and reset the RMS level of each band, in dB */
+void bands_read( bands_t *bands, float bias, float *db )
+{
+	const unsigned long frames = bands->frames;
+	unsigned int i;
+
+	for (i=0; i < bands->count; i++) {
+		const double ms = frames ? bands->energy[i] / frames : 0.0;
+		bands->energy[i] = 0.0;
+		db[i] = 10.0f * log10f( ms * bias * bias );
+	}
+
+	bands->frames = 0;
+}
+
+
+void bands_free( bands_t *bands )
+{
+	if (bands == NULL) return;
+
+	biquad_bank_free( bands->bank );
+	free( bands->energy );
+	free( bands );
+}
@@ -0,0 +1,56 @@
+/*
+
+	bands.h
+	Octave and third-octave band level meter for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _BANDS_H_
+#define _BANDS_H_
+
+#include "biquad.h"
+
+
+/* Each band is a 6th order Butterworth band-pass (IEC 61260 class 1 shape) */
+#define BANDS_ORDER		3
+
+/* Most bands there can be (third-octave, 25Hz to 20kHz) */
+#define BANDS_MAX		30
+
+
+typedef struct {
+	unsigned int count;
+	const char *label[BANDS_MAX];
+	double centre[BANDS_MAX];
+
+	biquad_bank_t *bank;
+
+	/* Sum of squares of each band since the last read */
+	double *energy;
+	unsigned long frames;
+} bands_t;
+
+
+/* per_octave is 1 or 3 */
+bands_t *bands_new( int per_octave, double samplerate );
+void bands_process( bands_t *bands, const float *in, unsigned int nframes );
+void bands_read( bands_t *bands, float bias, float *db );
+void bands_free( bands_t *bands );
+
+
+#endif
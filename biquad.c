@@ -0,0 +1,130 @@
+/*
+
+	biquad.c
+	Banks of second-order IIR filter sections for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "biquad.h"
+
+
+biquad_bank_t *biquad_bank_new( unsigned int lanes, unsigned int stages )
+{
+	biquad_bank_t *bank = malloc( sizeof(biquad_bank_t) );
+	unsigned int size;
+	double *mem;
+
+	if (bank == NULL) return NULL;
+
+	// Round up, so that the padding lanes are just silent filters
+	lanes = (lanes + BIQUAD_LANE_ALIGN - 1) / BIQUAD_LANE_ALIGN * BIQUAD_LANE_ALIGN;
+	size = lanes * stages;
+
+	// One block for the coefficients, state and lane buffer
+	mem = calloc( size * 7 + lanes, sizeof(double) );
+	if (mem == NULL) {
+		free( bank );
+		return NULL;
+	}
+
+	bank->lanes = lanes;
+	bank->stages = stages;
+	bank->b0 = mem;
+	bank->b1 = mem + size;
+	bank->b2 = mem + size * 2;
+	bank->a1 = mem + size * 3;
+	bank->a2 = mem + size * 4;
+	bank->z1 = mem + size * 5;
+	bank->z2 = mem + size * 6;
+	bank->x = mem + size * 7;
+
+	return bank;
+}
+
+
+void biquad_bank_set( biquad_bank_t *bank, unsigned int lane, unsigned int stage, const biquad_coeffs_t *c )
+{
+	const unsigned int i = stage * bank->lanes + lane;
+
+	bank->b0[i] = c->b0;
+	bank->b1[i] = c->b1;
+	bank->b2[i] = c->b2;
+	bank->a1[i] = c->a1;
+	bank->a2[i] = c->a2;
+}
+
+
+void biquad_bank_reset( biquad_bank_t *bank )
+{
+	const unsigned int size = bank->lanes * bank->stages;
+
+	memset( bank->z1, 0, sizeof(double) * size );
+	memset( bank->z2, 0, sizeof(double) * size );
+	memset( bank->x, 0, sizeof(double) * bank->lanes );
+}
+
+
+void biquad_bank_free( biquad_bank_t *bank )
+{
+	if (bank == NULL) return;
+
+	// The other arrays share this allocation
+	free( bank->b0 );
+	free( bank );
+}
+
+
+double biquad_prewarp( double freq, double samplerate )
+{
+	return 2.0 * samplerate * tan( M_PI * freq / samplerate );
+}
+
+
+void biquad_bilinear( double n2, double n1, double n0,
+                      double d2, double d1, double d0,
+                      double samplerate, biquad_coeffs_t *c )
+{
+	const double k = 2.0 * samplerate;
+	const double kk = k * k;
+	const double a0 = d2 * kk + d1 * k + d0;
+
+	c->b0 = (n2 * kk + n1 * k + n0) / a0;
+	c->b1 = 2.0 * (n0 - n2 * kk) / a0;
+	c->b2 = (n2 * kk - n1 * k + n0) / a0;
+	c->a1 = 2.0 * (d0 - d2 * kk) / a0;
+	c->a2 = (d2 * kk - d1 * k + d0) / a0;
+}
+
+
+double biquad_magnitude( const biquad_coeffs_t *c, double freq, double samplerate )
+{
+	const double w = 2.0 * M_PI * freq / samplerate;
+	const double c1 = cos( w ), c2 = cos( 2.0 * w );
+	const double s1 = sin( w ), s2 = sin( 2.0 * w );
+	const double nr = c->b0 + c->b1 * c1 + c->b2 * c2;
+	const double ni = c->b1 * s1 + c->b2 * s2;
+	const double dr = 1.0 + c->a1 * c1 + c->a2 * c2;
+	const double di = c->a1 * s1 + c->a2 * s2;
+
+	return sqrt( (nr * nr + ni * ni) / (dr * dr + di * di) );
+}
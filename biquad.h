@@ -0,0 +1,107 @@
+/*
+
+	biquad.h
+	Banks of second-order IIR filter sections for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _BIQUAD_H_
+#define _BIQUAD_H_
+
+
+/* Number of lanes are rounded up to a multiple of this,
+   so that the inner loops never have a scalar remainder */
+#define BIQUAD_LANE_ALIGN	4
+
+
+/* Coefficients for one section, normalised so that a0 is 1 */
+typedef struct {
+	double b0, b1, b2;
+	double a1, a2;
+} biquad_coeffs_t;
+
+
+/*
+	A bank of independent filters (lanes), each one a cascade of
+	the same number of sections (stages).
+
+	Everything is stored stage-major with one entry per lane, so
+	running a stage is the same arithmetic over contiguous arrays,
+	which the compiler turns into SIMD code. A lane can be a band
+	of an analyser fed with the same signal, or one channel of a
+	multi-channel filter.
+*/
+typedef struct {
+	unsigned int lanes;
+	unsigned int stages;
+
+	double *b0, *b1, *b2, *a1, *a2;
+	double *z1, *z2;
+
+	/* Input to / output from biquad_bank_tick(), one per lane */
+	double *x;
+} biquad_bank_t;
+
+
+biquad_bank_t *biquad_bank_new( unsigned int lanes, unsigned int stages );
+void biquad_bank_set( biquad_bank_t *bank, unsigned int lane, unsigned int stage, const biquad_coeffs_t *c );
+void biquad_bank_reset( biquad_bank_t *bank );
+void biquad_bank_free( biquad_bank_t *bank );
+
+/* Bilinear transform of (n2.s^2 + n1.s + n0) / (d2.s^2 + d1.s + d0) */
+void biquad_bilinear( double n2, double n1, double n0,
+                      double d2, double d1, double d0,
+                      double samplerate, biquad_coeffs_t *c );
+
+/* Pre-warp an analogue frequency (Hz) to rad/s for biquad_bilinear() */
+double biquad_prewarp( double freq, double samplerate );
+
+/* Magnitude response of a section at freq (Hz) */
+double biquad_magnitude( const biquad_coeffs_t *c, double freq, double samplerate );
+
+
+/* Run one sample through every lane of the bank, in place in bank->x */
+static inline void biquad_bank_tick( biquad_bank_t *bank )
+{
+	const unsigned int lanes = bank->lanes;
+	double * restrict x = bank->x;
+	unsigned int s, l;
+
+	for (s=0; s < bank->stages; s++) {
+		const unsigned int o = s * lanes;
+		const double * restrict b0 = bank->b0 + o;
+		const double * restrict b1 = bank->b1 + o;
+		const double * restrict b2 = bank->b2 + o;
+		const double * restrict a1 = bank->a1 + o;
+		const double * restrict a2 = bank->a2 + o;
+		double * restrict z1 = bank->z1 + o;
+		double * restrict z2 = bank->z2 + o;
+
+		// Transposed direct form II
+		for (l=0; l < lanes; l++) {
+			const double in = x[l];
+			const double out = b0[l] * in + z1[l];
+			z1[l] = b1[l] * in - a1[l] * out + z2[l];
+			z2[l] = b2[l] * in - a2[l] * out;
+			x[l] = out;
+		}
+	}
+}
+
+
+#endif
@@ -0,0 +1,117 @@
+/*
+
+	cv.c
+	Control voltage level outputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "cv.h"
+
+
+cv_t *cv_new( const char *spec, double samplerate, float bias )
+{
+	cv_t *cv = calloc( 1, sizeof(cv_t) );
+
+	if (cv == NULL) return NULL;
+
+	cv->bias = bias;
+	cv->fall = pow( 0.1, 1.0 / (CV_PEAK_FALL_SECS * samplerate) );
+	cv->rms_coeff = 1.0 - exp( -1.0 / (CV_RMS_SECS * samplerate) );
+
+	while (*spec) {
+		const unsigned int n = cv->count;
+		size_t len = strcspn( spec, ",:" );
+
+		if (n >= CV_MAX) break;
+
+		if (len == 4 && strncmp( spec, "peak", 4 ) == 0) {
+			cv->type[n] = CV_PEAK;
+		} else if (len == 3 && strncmp( spec, "rms", 3 ) == 0) {
+			cv->type[n] = CV_RMS;
+		} else {
+			break;
+		}
+		spec += len;
+
+		if (strncmp( spec, ":block", 6 ) == 0) {
+			cv->block[n] = 1;
+			spec += 6;
+		}
+		snprintf( cv->name[n], sizeof(cv->name[n]), "%s%s",
+			cv->type[n] == CV_PEAK ? "peak" : "rms", cv->block[n] ? "_block" : "" );
+		cv->count++;
+
+		if (*spec == ',') spec++;
+		else if (*spec) break;
+	}
+
+	if (*spec || cv->count == 0) {
+		cv_free( cv );
+		return NULL;
+	}
+
+	return cv;
+}
+
+
+/* Called from the JACK process callback */
+void cv_process( cv_t *cv, const float *in, const float *rms, float **out, unsigned int nframes )
+{
+	unsigned int c, i;
+
+	for (c=0; c < cv->count; c++) {
+		float *o = out[c];
+		float env = cv->env[c];
+
+		if (cv->type[c] == CV_PEAK) {
+			const float fall = cv->fall;
+
+			for (i=0; i < nframes; i++) {
+				const float s = fabsf( in[i] ) * cv->bias;
+				env = (s > env * fall) ? s : env * fall;
+				o[i] = env;
+			}
+		} else {
+			// Mean square envelope, square rooted on the way out
+			const float a = cv->rms_coeff;
+			const float bias2 = cv->bias * cv->bias;
+
+			for (i=0; i < nframes; i++) {
+				env += a * (rms[i] * rms[i] * bias2 - env);
+				o[i] = sqrtf( env );
+			}
+		}
+
+		if (cv->block[c] && nframes) {
+			const float last = o[nframes-1];
+			for (i=0; i < nframes; i++) o[i] = last;
+		}
+		cv->env[c] = env;
+	}
+}
+
+
+void cv_free( cv_t *cv )
+{
+	free( cv );
+}
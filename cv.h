@@ -0,0 +1,68 @@
+/*
+
+	cv.h
+	Control voltage level outputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _CV_H_
+#define _CV_H_
+
+
+#define CV_MAX				4
+
+/* Peak envelope falls 20dB in this time, like a PPM */
+#define CV_PEAK_FALL_SECS	1.7
+
+/* Time constant of the RMS envelope */
+#define CV_RMS_SECS			0.3
+
+
+enum { CV_PEAK = 0, CV_RMS };
+
+
+/*
+	Level envelopes written to output ports, so that other clients
+	get them sample synchronously. Values are linear, with 1.0 at the
+	meter's reference level. Audio rate outputs follow the envelope
+	sample by sample; block rate ones hold the value at the end of
+	each period.
+*/
+typedef struct {
+	unsigned int count;
+	int type[CV_MAX];
+	int block[CV_MAX];
+	char name[CV_MAX][16];
+
+	float bias;
+	float fall;
+	float rms_coeff;
+
+	float env[CV_MAX];
+} cv_t;
+
+
+/* spec is a comma separated list of peak or rms, each optionally :block */
+cv_t *cv_new( const char *spec, double samplerate, float bias );
+
+/* rms is the signal for the RMS envelopes, the weighted one if there is one */
+void cv_process( cv_t *cv, const float *in, const float *rms, float **out, unsigned int nframes );
+void cv_free( cv_t *cv );
+
+
+#endif
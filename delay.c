@@ -0,0 +1,163 @@
+/*
+
+	delay.c
+	Delay measurement between two inputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "delay.h"
+
+
+delay_t *delay_new( unsigned int size )
+{
+	delay_t *d = calloc( 1, sizeof(delay_t) );
+	unsigned int i;
+
+	if (d == NULL) return NULL;
+
+	d->size = size;
+	d->fft = fft_new( size );
+	d->a = calloc( size, sizeof(float) );
+	d->b = calloc( size, sizeof(float) );
+	d->window = malloc( sizeof(float) * size / 2 );
+	d->fa = malloc( sizeof(float complex) * size );
+	d->fb = malloc( sizeof(float complex) * size );
+	d->cross = calloc( size, sizeof(float complex) );
+	if (!d->fft || !d->a || !d->b || !d->window || !d->fa || !d->fb || !d->cross) {
+		delay_free( d );
+		return NULL;
+	}
+
+	// Hann window over the half block of the main input
+	for (i=0; i < size / 2; i++) {
+		d->window[i] = 0.5f - 0.5f * cosf( 2.0f * M_PI * i / (size / 2) );
+	}
+
+	return d;
+}
+
+
+/* Correlate the latest block and find the peak */
+static void delay_estimate( delay_t *d )
+{
+	const unsigned int size = d->size;
+	const unsigned int quarter = size / 4;
+	float best = 0.0f;
+	unsigned int i, peak = 0;
+
+	// Unroll the rings, oldest sample first, keeping only the middle half of the main input
+	for (i=0; i < size; i++) {
+		const unsigned int r = (d->pos + i) % size;
+		d->fa[i] = (i >= quarter && i < size - quarter) ? d->a[r] * d->window[i - quarter] : 0.0f;
+		d->fb[i] = d->b[r];
+	}
+	fft_forward( d->fft, d->fa );
+	fft_forward( d->fft, d->fb );
+
+	// Average the cross spectrum, then whiten it
+	for (i=0; i < size; i++) {
+		float complex g;
+		float mag;
+
+		d->cross[i] = DELAY_SMOOTHING * d->cross[i] + (1.0f - DELAY_SMOOTHING) * conjf( d->fa[i] ) * d->fb[i];
+		g = d->cross[i];
+		mag = cabsf( g );
+		d->fa[i] = (mag > 1e-20f) ? g / mag : 0.0f;
+	}
+	fft_inverse( d->fft, d->fa );
+
+	// Only lags of up to a quarter block either way are free of wrap around
+	for (i=0; i < size; i++) {
+		const float v = fabsf( crealf( d->fa[i] ) );
+		if (v > best && (i <= quarter || i >= size - quarter)) {
+			best = v;
+			peak = i;
+		}
+	}
+
+	d->delay = (peak < size / 2) ? (int) peak : (int) peak - (int) size;
+	// The main input covers half the block, so identical inputs peak at a half
+	d->confidence = fminf( best * 2.0f, 1.0f );
+	d->inverted = crealf( d->fa[peak] ) < 0.0f;
+	d->estimates++;
+}
+
+
+/*
+	Add interleaved pairs of samples (main, compare).
+	Returns non-zero if there is a new estimate.
+*/
+int delay_add( delay_t *d, const float *frames, unsigned int nframes )
+{
+	int updated = 0;
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		d->a[d->pos] = frames[i*2];
+		d->b[d->pos] = frames[i*2+1];
+		d->pos = (d->pos + 1) % d->size;
+
+		// A new block every half block
+		if (++d->total >= d->size && d->total % (d->size / 2) == 0) {
+			delay_estimate( d );
+			updated = 1;
+		}
+	}
+
+	return updated;
+}
+
+
+/* Print the estimate if it has changed since last time */
+void delay_report( delay_t *d, double samplerate, FILE *out )
+{
+	const int good = d->confidence >= DELAY_MIN_CONFIDENCE;
+
+	if (d->estimates == 0) return;
+
+	if (good && (!d->reported || d->delay != d->reported_delay || d->inverted != d->reported_inverted)) {
+		fprintf(out, "Delay: %d samples (%1.2fms), confidence %1.0f%%, polarity %s\n",
+			d->delay, 1000.0 * d->delay / samplerate, 100.0f * d->confidence,
+			d->inverted ? "inverted" : "normal");
+		d->reported_delay = d->delay;
+		d->reported_inverted = d->inverted;
+		d->reported = 1;
+	} else if (!good && d->reported) {
+		fprintf(out, "Delay: no correlation between the inputs\n");
+		d->reported = 0;
+	}
+}
+
+
+void delay_free( delay_t *d )
+{
+	if (d == NULL) return;
+
+	fft_free( d->fft );
+	free( d->a );
+	free( d->b );
+	free( d->window );
+	free( d->fa );
+	free( d->fb );
+	free( d->cross );
+	free( d );
+}
@@ -0,0 +1,84 @@
+/*
+
+	delay.h
+	Delay measurement between two inputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _DELAY_H_
+#define _DELAY_H_
+
+#include <stdio.h>
+#include "fft.h"
+
+
+/* FFT length; delays of up to a quarter of this either way can be measured */
+#define DELAY_FFT_SIZE		65536
+#define DELAY_MAX			(DELAY_FFT_SIZE / 4)
+
+/* Weight of the previous cross spectrum in the running average */
+#define DELAY_SMOOTHING		0.8f
+
+/* Estimates with less confidence than this are not reported */
+#define DELAY_MIN_CONFIDENCE	0.1f
+
+
+/*
+	Generalized cross-correlation with phase transform (GCC-PHAT),
+	by overlap-save. Every half block, the latest DELAY_FFT_SIZE
+	samples of the compare input are transformed along with the
+	middle half of the same span of the main input, zero padded by a
+	quarter either side. Their circular correlation is then the linear
+	one for lags of up to a quarter block either way, so a delay can't
+	alias to another. The cross spectra are averaged; whitening that to
+	unit magnitude and transforming back gives a correlation with a
+	sharp peak at the delay, whatever the spectrum of the signal.
+*/
+typedef struct {
+	unsigned int size;
+	fft_t *fft;
+
+	/* Latest 'size' samples of each input, as rings */
+	float *a, *b;
+	unsigned int pos;
+	unsigned long total;
+
+	float *window;
+	float complex *fa, *fb;
+	float complex *cross;
+
+	/* Latest estimate: compare lags main by 'delay' samples */
+	int delay;
+	float confidence;
+	int inverted;
+	unsigned long estimates;
+
+	/* What was last reported */
+	int reported;
+	int reported_delay;
+	int reported_inverted;
+} delay_t;
+
+
+delay_t *delay_new( unsigned int size );
+int delay_add( delay_t *d, const float *frames, unsigned int nframes );
+void delay_report( delay_t *d, double samplerate, FILE *out );
+void delay_free( delay_t *d );
+
+
+#endif
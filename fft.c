@@ -0,0 +1,145 @@
+/*
+
+	fft.c
+	Fast Fourier Transform for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "fft.h"
+
+
+fft_t *fft_new( unsigned int size )
+{
+	fft_t *fft;
+	unsigned int i, bits = 0;
+
+	if (size < 2 || (size & (size - 1))) return NULL;
+	while ((1U << bits) < size) bits++;
+
+	fft = malloc( sizeof(fft_t) );
+	if (fft == NULL) return NULL;
+
+	fft->size = size;
+	fft->reverse = malloc( sizeof(unsigned int) * size );
+	fft->twiddle = malloc( sizeof(float complex) * size / 2 );
+	if (fft->reverse == NULL || fft->twiddle == NULL) {
+		fft_free( fft );
+		return NULL;
+	}
+
+	for (i=0; i < size; i++) {
+		unsigned int r = 0, b;
+		for (b=0; b < bits; b++) {
+			if (i & (1U << b)) r |= 1U << (bits - 1 - b);
+		}
+		fft->reverse[i] = r;
+	}
+
+	for (i=0; i < size / 2; i++) {
+		fft->twiddle[i] = cexp( -2.0 * M_PI * I * i / size );
+	}
+
+	return fft;
+}
+
+
+/* One radix-2 stage of butterflies of length len, over span entries of buf */
+static void fft_stage( const fft_t *fft, float complex *buf, unsigned int span, unsigned int len, float sign )
+{
+	const unsigned int half = len / 2;
+	const unsigned int step = fft->size / len;
+	unsigned int start, k;
+
+	for (start=0; start < span; start += len) {
+		float complex *lo = buf + start;
+		float complex *hi = buf + start + half;
+
+		// Real arithmetic, which avoids the C99 checks for infinities
+		for (k=0; k < half; k++) {
+			const float complex w = fft->twiddle[k * step];
+			const float wr = crealf( w ), wi = sign * cimagf( w );
+			const float hr = crealf( hi[k] ), hm = cimagf( hi[k] );
+			const float tr = hr * wr - hm * wi;
+			const float ti = hr * wi + hm * wr;
+			const float lr = crealf( lo[k] ), lm = cimagf( lo[k] );
+
+			hi[k] = CMPLXF( lr - tr, lm - ti );
+			lo[k] = CMPLXF( lr + tr, lm + ti );
+		}
+	}
+}
+
+
+static void fft_run( const fft_t *fft, float complex *buf, int inverse )
+{
+	const unsigned int size = fft->size;
+	const unsigned int block = size < FFT_BLOCK ? size : FFT_BLOCK;
+	const float sign = inverse ? -1.0f : 1.0f;
+	unsigned int i, len;
+
+	for (i=0; i < size; i++) {
+		const unsigned int r = fft->reverse[i];
+		if (r > i) {
+			const float complex tmp = buf[i];
+			buf[i] = buf[r];
+			buf[r] = tmp;
+		}
+	}
+
+	// The short stages are finished one cache sized block at a time,
+	// rather than each one making a pass over the whole buffer
+	for (i=0; i < size; i += block) {
+		for (len=2; len <= block; len <<= 1) {
+			fft_stage( fft, buf + i, block, len, sign );
+		}
+	}
+	for (len=block*2; len <= size; len <<= 1) {
+		fft_stage( fft, buf, size, len, sign );
+	}
+}
+
+
+void fft_forward( const fft_t *fft, float complex *buf )
+{
+	fft_run( fft, buf, 0 );
+}
+
+
+/* Scaled by 1/size, so that it undoes fft_forward() */
+void fft_inverse( const fft_t *fft, float complex *buf )
+{
+	const float scale = 1.0f / fft->size;
+	unsigned int i;
+
+	fft_run( fft, buf, 1 );
+	for (i=0; i < fft->size; i++) buf[i] *= scale;
+}
+
+
+void fft_free( fft_t *fft )
+{
+	if (fft == NULL) return;
+
+	free( fft->reverse );
+	free( fft->twiddle );
+	free( fft );
+}
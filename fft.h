@@ -0,0 +1,48 @@
+/*
+
+	fft.h
+	Fast Fourier Transform for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _FFT_H_
+#define _FFT_H_
+
+#include <complex.h>
+
+
+/* Stages of the transform up to this length are done a block at a time */
+#define FFT_BLOCK	4096
+
+
+/* Radix-2 complex FFT, with the tables worked out once up front */
+typedef struct {
+	unsigned int size;
+	unsigned int *reverse;
+	float complex *twiddle;
+} fft_t;
+
+
+/* size must be a power of two */
+fft_t *fft_new( unsigned int size );
+void fft_forward( const fft_t *fft, float complex *buf );
+void fft_inverse( const fft_t *fft, float complex *buf );
+void fft_free( fft_t *fft );
+
+
+#endif
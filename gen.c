@@ -0,0 +1,209 @@
+/*
+
+	gen.c
+	Test signal generator for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "gen.h"
+
+
+static const char *gen_names[] = { "tone", "pink", "sweep", "ident" };
+
+
+/* Paul Kellet's economy pink noise filter */
+static inline float pink_filter( float *b, float white )
+{
+	b[0] = 0.99765f * b[0] + white * 0.0990460f;
+	b[1] = 0.96300f * b[1] + white * 0.2965164f;
+	b[2] = 0.57000f * b[2] + white * 1.0526913f;
+
+	return b[0] + b[1] + b[2] + white * 0.1848f;
+}
+
+
+gen_t *gen_new( const char *spec, double samplerate, float bias )
+{
+	gen_t *gen;
+	float level = -18.0f;
+	const char *arg;
+	int type, i;
+
+	for (type=0; type <= GEN_IDENT; type++) {
+		const size_t len = strlen( gen_names[type] );
+		if (strncmp( spec, gen_names[type], len ) == 0 && (spec[len] == ':' || spec[len] == 0)) break;
+	}
+	if (type > GEN_IDENT) return NULL;
+
+	gen = calloc( 1, sizeof(gen_t) );
+	if (gen == NULL) return NULL;
+
+	gen->type = type;
+	gen->samplerate = samplerate;
+	gen->freq = 1000.0;
+
+	// Tones take a frequency and then a level, the others just a level
+	arg = strchr( spec, ':' );
+	if (arg && (type == GEN_TONE || type == GEN_IDENT)) {
+		gen->freq = atof( arg + 1 );
+		arg = strchr( arg + 1, ':' );
+	}
+	if (arg) {
+		level = atof( arg + 1 );
+	}
+	if (gen->freq <= 0.0 || gen->freq >= samplerate / 2) {
+		free( gen );
+		return NULL;
+	}
+
+	// Calibrated so the meter reads 'level'
+	gen->amplitude = powf( 10.0f, level * 0.05f ) / bias;
+
+	if (type == GEN_PINK) {
+		float b[3] = { 0.0f, 0.0f, 0.0f };
+		double energy = 0.0;
+
+		// RMS out of the filter is the energy of its impulse response
+		// times the variance of the white noise (1/3 for -1 to 1)
+		for (i=0; i < 100000; i++) {
+			const float h = pink_filter( b, i ? 0.0f : 1.0f );
+			energy += h * h;
+		}
+		gen->pink_scale = gen->amplitude / sqrt( energy / 3.0 ) / 2147483648.0;
+
+		for (i=0; i < GEN_LANES; i++) {
+			gen->seed[i] = 0x9e3779b9u * (i + 1);
+		}
+	}
+
+	return gen;
+}
+
+
+/* Sine at a fixed frequency, GEN_LANES samples at a time */
+static void gen_sine( gen_t *gen, float *out, unsigned int nframes, double freq )
+{
+	const double w = 2.0 * M_PI * freq / gen->samplerate;
+	const float step_re = cos( w * GEN_LANES ), step_im = sin( w * GEN_LANES );
+	float re[GEN_LANES], im[GEN_LANES];
+	unsigned int i, l;
+
+	// Phasors for the first GEN_LANES samples, from the running phase
+	for (l=0; l < GEN_LANES; l++) {
+		re[l] = cos( gen->phase + w * l );
+		im[l] = sin( gen->phase + w * l );
+	}
+
+	for (i=0; i + GEN_LANES <= nframes; i += GEN_LANES) {
+		for (l=0; l < GEN_LANES; l++) {
+			const float r = re[l] * step_re - im[l] * step_im;
+			out[i+l] = gen->amplitude * im[l];
+			im[l] = re[l] * step_im + im[l] * step_re;
+			re[l] = r;
+		}
+	}
+	for (l=0; i < nframes; i++, l++) {
+		out[i] = gen->amplitude * im[l];
+	}
+
+	gen->phase = fmod( gen->phase + w * nframes, 2.0 * M_PI );
+}
+
+
+static void gen_pink( gen_t *gen, float *out, unsigned int nframes )
+{
+	const float scale = gen->pink_scale;
+	unsigned int i, l;
+
+	// White noise from independent xorshift generators
+	for (i=0; i + GEN_LANES <= nframes; i += GEN_LANES) {
+		for (l=0; l < GEN_LANES; l++) {
+			uint32_t x = gen->seed[l];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			gen->seed[l] = x;
+			out[i+l] = (float)(int32_t) x;
+		}
+	}
+	for (; i < nframes; i++) {
+		uint32_t x = gen->seed[0];
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		gen->seed[0] = x;
+		out[i] = (float)(int32_t) x;
+	}
+
+	// The filter has to run in order
+	for (i=0; i < nframes; i++) {
+		out[i] = pink_filter( gen->pink, out[i] * scale );
+	}
+}
+
+
+/* Called from the JACK process callback, writes straight into the port buffer */
+void gen_process( gen_t *gen, float *out, unsigned int nframes )
+{
+	switch (gen->type) {
+		case GEN_TONE:
+			gen_sine( gen, out, nframes, gen->freq );
+			break;
+
+		case GEN_PINK:
+			gen_pink( gen, out, nframes );
+			break;
+
+		case GEN_SWEEP: {
+			// Exponential sweep, frequency stepped once per period
+			const double t = gen->pos / gen->samplerate;
+			const double freq = GEN_SWEEP_START * pow( GEN_SWEEP_END / GEN_SWEEP_START, t / GEN_SWEEP_SECS );
+
+			gen_sine( gen, out, nframes, freq );
+			gen->pos += nframes;
+			if (gen->pos >= GEN_SWEEP_SECS * gen->samplerate) {
+				gen->pos = 0;
+			}
+			break;
+		}
+
+		case GEN_IDENT: {
+			const unsigned long period = GEN_IDENT_SECS * gen->samplerate;
+			const unsigned long gap = GEN_IDENT_GAP_SECS * gen->samplerate;
+			unsigned int i;
+
+			gen_sine( gen, out, nframes, gen->freq );
+			for (i=0; i < nframes; i++) {
+				if ((gen->pos + i) % period < gap) out[i] = 0.0f;
+			}
+			gen->pos = (gen->pos + nframes) % period;
+			break;
+		}
+	}
+}
+
+
+void gen_free( gen_t *gen )
+{
+	free( gen );
+}
@@ -0,0 +1,72 @@
+/*
+
+	gen.h
+	Test signal generator for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _GEN_H_
+#define _GEN_H_
+
+#include <stdint.h>
+
+
+/* Samples worked out side by side by the oscillator and noise generator */
+#define GEN_LANES			8
+
+/* Sweeps go from 20Hz to 20kHz over 10 seconds, then start again */
+#define GEN_SWEEP_START		20.0
+#define GEN_SWEEP_END		20000.0
+#define GEN_SWEEP_SECS		10.0
+
+/* Ident tone is broken for 250ms every 3 seconds */
+#define GEN_IDENT_SECS		3.0
+#define GEN_IDENT_GAP_SECS	0.25
+
+
+enum { GEN_TONE = 0, GEN_PINK, GEN_SWEEP, GEN_IDENT };
+
+
+typedef struct {
+	int type;
+	double samplerate;
+	float amplitude;
+
+	/* Oscillator */
+	double freq;
+	double phase;
+	unsigned long pos;
+
+	/* Noise */
+	uint32_t seed[GEN_LANES];
+	float pink[3];
+	float pink_scale;
+} gen_t;
+
+
+/*
+	spec is type[:freq][:level], where type is tone, pink, sweep or ident.
+	Levels are in dB on the meter's scale, so bias is the meter's bias;
+	peak level for tones and sweeps, RMS level for noise.
+*/
+gen_t *gen_new( const char *spec, double samplerate, float bias );
+void gen_process( gen_t *gen, float *out, unsigned int nframes );
+void gen_free( gen_t *gen );
+
+
+#endif
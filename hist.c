@@ -0,0 +1,166 @@
+/*
+
+	hist.c
+	Sample level histogram for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "hist.h"
+
+
+/* Number of bins to a row of the report (3dB) */
+#define HIST_REPORT_BINS	6
+
+/* Width of the bars in the report */
+#define HIST_REPORT_WIDTH	40
+
+
+hist_t *hist_new( void )
+{
+	hist_t *hist = calloc( 1, sizeof(hist_t) );
+	int m;
+
+	if (hist == NULL) return NULL;
+
+	// Which twelfth of the octave each value of the top 8 mantissa bits is in
+	for (m=0; m < 256; m++) {
+		hist->sub_bin[m] = (uint8_t)( log2( 1.0 + (m + 0.5) / 256.0 ) * HIST_BINS_PER_OCTAVE );
+	}
+
+	return hist;
+}
+
+
+/* Called from the JACK process callback */
+void hist_process( hist_t *hist, const float *in, unsigned int nframes )
+{
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		uint32_t bits;
+		int octave;
+
+		memcpy( &bits, &in[i], sizeof(bits) );
+		bits &= 0x7fffffff;
+
+		// Exponent 126 is [0.5, 1.0), the top octave
+		octave = 126 - (int)(bits >> 23);
+
+		if (bits == 0) {
+			hist->zero++;
+		} else if (octave < 0) {
+			hist->full_scale++;
+		} else if (octave >= HIST_OCTAVES) {
+			hist->under++;
+		} else {
+			const int bin = (HIST_OCTAVES - 1 - octave) * HIST_BINS_PER_OCTAVE
+			              + hist->sub_bin[ (bits >> 15) & 0xff ];
+			hist->bins[bin]++;
+		}
+	}
+}
+
+
+/* Level in dBFS of the bottom edge of a bin */
+static float bin_level( int bin )
+{
+	return (float)(bin - HIST_BINS) / HIST_BINS_PER_OCTAVE * 6.0206f;
+}
+
+
+/* Level below which a fraction q of the non-zero samples lie */
+static float hist_quantile( const hist_t *hist, uint64_t total, double q )
+{
+	const uint64_t rank = (uint64_t)(q * total);
+	uint64_t seen = hist->under;
+	int i;
+
+	if (seen > rank) return bin_level( 0 );
+	for (i=0; i < HIST_BINS; i++) {
+		seen += hist->bins[i];
+		if (seen > rank) return bin_level( i + 1 );
+	}
+
+	return 0.0f;
+}
+
+
+void hist_report( const hist_t *hist, float bias, FILE *out )
+{
+	const float offset = 20.0f * log10f( bias );
+	uint64_t total = hist->under + hist->full_scale;
+	uint64_t rows[HIST_BINS / HIST_REPORT_BINS];
+	uint64_t most = 0;
+	int i, top = -1, bottom = -1;
+	float p1, p50, p999;
+
+	memset( rows, 0, sizeof(rows) );
+	for (i=0; i < HIST_BINS; i++) {
+		rows[i / HIST_REPORT_BINS] += hist->bins[i];
+		total += hist->bins[i];
+		if (hist->bins[i]) {
+			if (bottom < 0) bottom = i;
+			top = i;
+		}
+	}
+
+	fprintf(out, "Sample level histogram (%llu samples, %llu digital silence):\n",
+		(unsigned long long) (total + hist->zero), (unsigned long long) hist->zero);
+	if (total == 0) return;
+
+	for (i=0; i < HIST_BINS / HIST_REPORT_BINS; i++) {
+		if (rows[i] > most) most = rows[i];
+	}
+
+	// Only the rows with something in, loudest first
+	for (i=top / HIST_REPORT_BINS; bottom >= 0 && i >= bottom / HIST_REPORT_BINS; i--) {
+		const int len = (int)(rows[i] * HIST_REPORT_WIDTH / most);
+		int j;
+
+		fprintf(out, "  %6.1f to %6.1fdB %6.2f%% ",
+			bin_level( i * HIST_REPORT_BINS ) + offset,
+			bin_level( (i+1) * HIST_REPORT_BINS ) + offset,
+			100.0 * rows[i] / total);
+		for (j=0; j < len; j++) fputc( '#', out );
+		fputc( '\n', out );
+	}
+
+	p1 = hist_quantile( hist, total, 0.01 ) + offset;
+	p50 = hist_quantile( hist, total, 0.50 ) + offset;
+	p999 = hist_quantile( hist, total, 0.999 ) + offset;
+
+	if (hist->under) {
+		fprintf(out, "  below %1.1fdB: %llu samples\n", bin_level( 0 ) + offset, (unsigned long long) hist->under);
+	}
+	fprintf(out, "  at or over full scale: %llu samples\n", (unsigned long long) hist->full_scale);
+	fprintf(out, "  peak: %1.1fdB, 99.9%%: %1.1fdB, median: %1.1fdB, 1%%: %1.1fdB\n",
+		hist->full_scale ? offset : bin_level( top + 1 ) + offset, p999, p50, p1);
+	fprintf(out, "  dynamic range (99.9%% to 1%%): %1.1fdB, headroom: %1.1fdB\n",
+		p999 - p1, hist->full_scale ? 0.0f : -bin_level( top + 1 ));
+}
+
+
+void hist_free( hist_t *hist )
+{
+	free( hist );
+}
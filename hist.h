@@ -0,0 +1,61 @@
+/*
+
+	hist.h
+	Sample level histogram for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _HIST_H_
+#define _HIST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+/* Bins are a twelfth of an octave, 0.502dB */
+#define HIST_BINS_PER_OCTAVE	12
+
+/* 24 octaves, down to -144dBFS */
+#define HIST_OCTAVES			24
+#define HIST_BINS				(HIST_OCTAVES * HIST_BINS_PER_OCTAVE)
+
+
+/*
+	Histogram of the absolute level of every sample. The bin is taken
+	straight from the bits of the float: the exponent gives the octave
+	and a table lookup on the top of the mantissa gives the bin within
+	it, so there is no log and the process callback only increments
+	integers.
+*/
+typedef struct {
+	uint64_t zero;
+	uint64_t under;
+	uint64_t bins[HIST_BINS];
+	uint64_t full_scale;
+
+	uint8_t sub_bin[256];
+} hist_t;
+
+
+hist_t *hist_new( void );
+void hist_process( hist_t *hist, const float *in, unsigned int nframes );
+void hist_report( const hist_t *hist, float bias, FILE *out );
+void hist_free( hist_t *hist );
+
+
+#endif
@@ -26,22 +26,143 @@
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <ctype.h>
+#include <signal.h>
+#include <sys/time.h>
 
 #include <jack/jack.h>
+#include <jack/ringbuffer.h>
 #include <getopt.h>
 #include "config.h"
+#include "bands.h"
+#include "weighting.h"
+#include "tones.h"
+#include "noise.h"
+#include "peaks.h"
+#include "leq.h"
+#include "sketch.h"
+#include "hist.h"
+#include "delay.h"
+#include "null.h"
+#include "loopback.h"
+#include "gen.h"
+#include "thd.h"
+#include "sweep.h"
+#include "cv.h"
+#include "midi.h"
+#include "osc.h"
+#include "metrics.h"
+#include "sink.h"
+#include "loudness.h"
+#include "align.h"
+#include "sources.h"
+
+
+/* Most frames of the compare port handled by the main loop at once */
+#define COMPARE_CHUNK	1024
+
+/* Most channel groups (-G) that can be metered together */
+#define GROUPS_MAX		4
+
+/* Range of buffer sizes the server can be switched between, so that
+   scratch buffers can be allocated up front for any of them */
+#define PERIOD_MIN		16
+#define PERIOD_MAX		8192
+
+/* How often the main loop looks at the analysers while freewheeling */
+#define FREEWHEEL_POLL	0.01f
 
 
 float bias = 1.0f;
 float peak = 0.0f;
+float last_peak = 0.0f;
+float window_peak = 0.0f;
+double window_sum = 0.0;
+unsigned int window_frames = 0;
 
 int dpeak = 0;
 int dtime = 0;
 int decay_len;
 char *server_name = NULL;
 jack_port_t *input_port = NULL;
+float *input_copy = NULL;
 jack_client_t *client = NULL;
 jack_options_t options = JackNoStartServer;
+bands_t *bands = NULL;
+weighting_t *weighting = NULL;
+float *weighted = NULL;
+double rms_sum = 0.0;
+unsigned long rms_frames = 0;
+tones_t *tones = NULL;
+noise_t *noise = NULL;
+peaks_t *peaks = NULL;
+leq_t *leq = NULL;
+jack_ringbuffer_t *level_rb = NULL;
+unsigned long level_len = 0;
+double level_sum = 0.0;
+unsigned long level_frames = 0;
+sketch_history_t *history = NULL;
+hist_t *hist = NULL;
+jack_port_t *compare_port = NULL;
+jack_ringbuffer_t *compare_rb = NULL;
+float *compare_pairs = NULL;
+delay_t *delay = NULL;
+null_t *null_test = NULL;
+jack_port_t *output_port = NULL;
+loopback_t *loopback = NULL;
+gen_t *gen = NULL;
+jack_ringbuffer_t *input_rb = NULL;
+thd_t *thd = NULL;
+sweep_t *sweep = NULL;
+cv_t *cv = NULL;
+jack_port_t *cv_ports[CV_MAX];
+midi_t *midi = NULL;
+jack_port_t *midi_port = NULL;
+osc_t *osc = NULL;
+metrics_t *metrics = NULL;
+sinks_t *sinks = NULL;
+int console_width = 79;
+loudness_t *groups[GROUPS_MAX];
+jack_port_t *group_ports[GROUPS_MAX][LOUDNESS_CHANNELS_MAX];
+unsigned int group_count = 0;
+align_t *aligns[GROUPS_MAX];
+float *group_copy[GROUPS_MAX][LOUDNESS_CHANNELS_MAX];
+sources_t *sources = NULL;
+jack_port_t *source_ports[SOURCES_MAX];
+volatile sig_atomic_t report_requested = 0;
+volatile sig_atomic_t realign_requested = 0;
+
+/* Options, kept for rebuilding the meters when the server changes */
+int bands_per_octave = 0;
+char weighting_type = 0;
+float hum_freq = 0.0f;
+float lineup_freq[TONES_MAX];
+float lineup_level[TONES_MAX];
+int lineup_count = 0;
+float noise_secs = 0.0f;
+char *peak_windows = NULL;
+char *leq_windows = NULL;
+char *gen_spec = NULL;
+char *cv_spec = NULL;
+char *midi_spec = NULL;
+float midi_rate = MIDI_RATE;
+const char *group_layouts[GROUPS_MAX];
+
+/* What the meters were built for, and the latest from the server */
+jack_nframes_t sample_rate = 0;
+jack_nframes_t buffer_size = 0;
+volatile jack_nframes_t new_sample_rate = 0;
+volatile jack_nframes_t new_buffer_size = 0;
+volatile unsigned long cycles = 0;
+
+/* A freewheel run, from its start to the end, kept by the process thread */
+volatile int freewheel = 0;
+int freewheeling = 0;
+float run_peak = 0.0f;
+unsigned long run_frames = 0;
+float run_integrated[GROUPS_MAX];
+float run_true_peak[GROUPS_MAX];
+volatile int run_done = 0;
 
 
 /* Read and reset the recent peak sample */
@@ -54,34 +175,444 @@ static float read_peak()
 }
 
 
-/* Callback called by JACK when audio is available.
-   Stores value of peak sample */
-static int process_peak(jack_nframes_t nframes, void *arg)
+/* Read and reset the mean square of the weighted signal */
+static double read_ms()
+{
+	double tmp = rms_frames ? rms_sum / rms_frames : 0.0;
+	rms_sum = 0.0;
+	rms_frames = 0;
+
+	return tmp;
+}
+
+
+/* Leave our outputs silent for a cycle that isn't metered */
+static void process_silence(jack_nframes_t nframes)
 {
-	jack_default_audio_sample_t *in;
 	unsigned int i;
 
+	if (output_port != NULL) {
+		memset( jack_port_get_buffer(output_port, nframes), 0, sizeof(float) * nframes );
+	}
+	for (i = 0; cv != NULL && i < cv->count; i++) {
+		memset( jack_port_get_buffer(cv_ports[i], nframes), 0, sizeof(float) * nframes );
+	}
+	if (midi_port != NULL) {
+		jack_midi_clear_buffer( jack_port_get_buffer(midi_port, nframes) );
+	}
+}
+
+
+/* Everything that reads or writes the ports, which JACK is kept waiting for.
+   Returns our copy of the input, or NULL to skip the rest of the cycle */
+static const float *process_ports(jack_nframes_t nframes)
+{
+	jack_default_audio_sample_t *in;
+	float block_peak = 0.0f;
+	unsigned int i, g;
+
 
 	/* just incase the port isn't registered yet */
-	if (input_port == NULL) {
-		return 0;
+	if (input_port == NULL || nframes > PERIOD_MAX) {
+		process_silence( nframes );
+		return NULL;
 	}
 
 
 	/* get the audio samples, and find the peak sample */
 	in = (jack_default_audio_sample_t *) jack_port_get_buffer(input_port, nframes);
+	if (sources != NULL) {
+		const float *buffers[SOURCES_MAX];
+
+		for (i = 0; i < sources->count; i++) {
+			buffers[i] = (const float *) jack_port_get_buffer(source_ports[i], nframes);
+		}
+		in = (jack_default_audio_sample_t *) sources_mix( sources, in, buffers, nframes );
+	} else {
+		/* the port buffer goes back to JACK when the cycle is signalled */
+		memcpy( input_copy, in, sizeof(float) * nframes );
+		in = input_copy;
+	}
 	for (i = 0; i < nframes; i++) {
 		const float s = fabs(in[i]);
-		if (s > peak) {
-			peak = s;
+		if (s > block_peak) {
+			block_peak = s;
+		}
+	}
+	if (block_peak > peak) {
+		peak = block_peak;
+	}
+	last_peak = block_peak;
+
+	/* level envelopes for other clients, from the weighted signal if there is one */
+	if (cv != NULL) {
+		float *out[CV_MAX];
+
+		if (weighting != NULL) {
+			weighting_process( weighting, in, weighted, nframes );
+		}
+		for (i = 0; i < cv->count; i++) {
+			out[i] = (float *) jack_port_get_buffer(cv_ports[i], nframes);
+		}
+		cv_process( cv, in, (weighting != NULL) ? weighted : in, out, nframes );
+	}
+
+	/* levels for control surfaces */
+	if (midi != NULL) {
+		midi_process( midi, in, jack_port_get_buffer(midi_port, nframes), nframes );
+	}
+
+	/* pass both inputs to the main thread to measure the delay between them */
+	if (compare_rb != NULL &&
+	    jack_ringbuffer_write_space( compare_rb ) >= sizeof(float) * nframes * 2) {
+		const float *cmp = (const float *) jack_port_get_buffer(compare_port, nframes);
+
+		for (i = 0; i < nframes; i++) {
+			compare_pairs[i*2] = in[i];
+			compare_pairs[i*2+1] = cmp[i];
+		}
+		jack_ringbuffer_write( compare_rb, (const char *) compare_pairs, sizeof(float) * nframes * 2 );
+	}
+
+	/* play and record the round trip latency burst */
+	if (loopback != NULL) {
+		float *out = (float *) jack_port_get_buffer(output_port, nframes);
+		loopback_process( loopback, in, out, nframes );
+	}
+
+	/* play the sweep and record what comes back */
+	if (sweep != NULL) {
+		float *out = (float *) jack_port_get_buffer(output_port, nframes);
+		sweep_process( sweep, in, out, nframes );
+	}
+
+	/* test signal generator */
+	if (gen != NULL) {
+		gen_process( gen, (float *) jack_port_get_buffer(output_port, nframes), nframes );
+	}
+
+	/* copy the channel groups for loudness, which is done afterwards */
+	for (g = 0; g < group_count; g++) {
+		for (i = 0; i < groups[g]->channels; i++) {
+			memcpy( group_copy[g][i], jack_port_get_buffer(group_ports[g][i], nframes), sizeof(float) * nframes );
+		}
+	}
+
+
+	return in;
+}
+
+
+/* The rest of the metering, once JACK has been signalled to carry on */
+static void process_levels(const float *in, jack_nframes_t nframes, unsigned long usecs, jack_time_t start)
+{
+	unsigned int i, g;
+
+
+	/* frequency weighting ahead of the RMS meter and Leq windows */
+	if (weighting != NULL || leq != NULL) {
+		const float *x = in;
+		double sum = 0.0;
+
+		if (weighting != NULL) {
+			if (cv == NULL) {
+				weighting_process( weighting, in, weighted, nframes );
+			}
+			x = weighted;
+		}
+		for (i = 0; i < nframes; i++) {
+			sum += x[i] * x[i];
+		}
+		rms_sum += sum;
+		rms_frames += nframes;
+	}
+
+	/* move the sliding windows on a block at a time */
+	if (peaks != NULL || leq != NULL) {
+		const float *x = (weighting != NULL) ? weighted : in;
+
+		for (i = 0; i < nframes; i++) {
+			const float s = fabsf(in[i]);
+			if (s > window_peak) {
+				window_peak = s;
+			}
+			window_sum += x[i] * x[i];
+
+			if (++window_frames == WINDOW_BLOCK) {
+				if (peaks != NULL) {
+					peaks_push( peaks, window_peak );
+				}
+				if (leq != NULL) {
+					leq_push( leq, window_sum / WINDOW_BLOCK );
+				}
+				window_peak = 0.0f;
+				window_sum = 0.0;
+				window_frames = 0;
+			}
+		}
+	}
+
+	/* levels for the OSC sender */
+	if (osc != NULL) {
+		osc_push( osc, in, nframes );
+	}
+
+	/* pass one second levels to the main thread for the quantile sketches */
+	if (level_rb != NULL) {
+		double sum = 0.0;
+
+		for (i = 0; i < nframes; i++) {
+			sum += in[i] * in[i];
+		}
+		level_sum += sum;
+		level_frames += nframes;
+
+		if (level_frames >= level_len) {
+			const float ms = level_sum / level_frames;
+			jack_ringbuffer_write( level_rb, (const char *) &ms, sizeof(ms) );
+			level_sum = 0.0;
+			level_frames = 0;
+		}
+	}
+
+	/* pass the input to the main thread for the THD+N measurement */
+	if (input_rb != NULL && jack_ringbuffer_write_space( input_rb ) >= sizeof(float) * nframes) {
+		jack_ringbuffer_write( input_rb, (const char *) in, sizeof(float) * nframes );
+	}
+
+	/* count sample levels for the histogram */
+	if (hist != NULL) {
+		hist_process( hist, in, nframes );
+	}
+
+	/* feed the octave band analyser */
+	if (bands != NULL) {
+		bands_process( bands, in, nframes );
+	}
+
+	/* look for hum and line-up tone */
+	if (tones != NULL) {
+		tones_process( tones, in, nframes );
+	}
+
+	/* track the noise floor */
+	if (noise != NULL) {
+		noise_process( noise, in, nframes );
+	}
+
+	/* look for the latency burst in what was recorded */
+	if (loopback != NULL) {
+		loopback_analyse( loopback );
+	}
+
+	/* loudness of each channel group, from its own ports */
+	for (g = 0; g < group_count; g++) {
+		const float *buffers[LOUDNESS_CHANNELS_MAX];
+
+		for (i = 0; i < groups[g]->channels; i++) {
+			buffers[i] = align_process( aligns[g], i, group_copy[g][i], nframes );
+		}
+		align_advance( aligns[g], nframes );
+		loudness_process( groups[g], buffers, nframes );
+		if (metrics != NULL) {
+			metrics_group( metrics, g, groups[g]->layout,
+				groups[g]->momentary, groups[g]->integrated, groups[g]->true_peak );
+		}
+	}
+
+	/* publish statistics for scrapes, last so that it can time the rest */
+	if (metrics != NULL) {
+		metrics_process( metrics, in, (weighting != NULL) ? weighted : NULL,
+			nframes, usecs, jack_get_time() - start );
+	}
+}
+
+
+/* Start metering a freewheel run, with the loudness integrated over just the run */
+static void start_run()
+{
+	unsigned int g;
+
+	run_peak = 0.0f;
+	run_frames = 0;
+	for (g = 0; g < group_count; g++) {
+		loudness_reset( groups[g] );
+	}
+}
+
+
+/* Keep the results of a freewheel run for the main loop to report */
+static void end_run()
+{
+	unsigned int g;
+
+	for (g = 0; g < group_count; g++) {
+		run_integrated[g] = groups[g]->integrated;
+		run_true_peak[g] = groups[g]->tp_max;
+	}
+	__sync_synchronize();
+	run_done = 1;
+}
+
+
+/*
+	Our own process thread. JACK is signalled as soon as the ports
+	have been dealt with, so the rest of the graph doesn't wait for
+	the filters and analysers, which work on our copies of the inputs
+	until the next cycle starts.
+*/
+static void *process_thread(void *arg)
+{
+	for (;;) {
+		const jack_nframes_t nframes = jack_cycle_wait( client );
+		const jack_time_t start = metrics ? jack_get_time() : 0;
+		const float *in;
+		unsigned long usecs;
+
+		if (freewheel != freewheeling) {
+			freewheeling = freewheel;
+			if (freewheeling) {
+				start_run();
+			} else {
+				end_run();
+			}
+		}
+
+		in = process_ports( nframes );
+		jack_cycle_signal( client, 0 );
+		usecs = metrics ? jack_get_time() - start : 0;
+
+		if (in != NULL) {
+			process_levels( in, nframes, usecs, start );
 		}
+		if (in != NULL && freewheeling) {
+			if (last_peak > run_peak) run_peak = last_peak;
+			run_frames += nframes;
+		}
+
+		/* let the main loop know when a cycle is over, for freeing old meters */
+		cycles++;
 	}
 
+	return NULL;
+}
+
 
+/* Callback called by JACK after an xrun */
+static int count_xrun(void *arg)
+{
+	metrics_xrun( metrics );
 	return 0;
 }
 
 
+/* Delay the channels of each group to line up with the one with the most capture latency,
+   from the main thread only */
+static void align_groups()
+{
+	unsigned int latency[LOUDNESS_CHANNELS_MAX];
+	jack_latency_range_t range;
+	unsigned int g, c;
+
+	for (g = 0; g < group_count; g++) {
+		for (c = 0; c < groups[g]->channels; c++) {
+			jack_port_get_latency_range( group_ports[g][c], JackCaptureLatency, &range );
+			latency[c] = range.max;
+		}
+
+		if (align_set_latencies( aligns[g], latency )) {
+			fprintf(stderr, "%s group %u alignment:", groups[g]->layout, g+1);
+			for (c = 0; c < groups[g]->channels; c++) {
+				fprintf(stderr, " %s %u", groups[g]->name[c], aligns[g]->delay[c]);
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+}
+
+
+/* Callback called by JACK when the graph changes, the main loop lines the groups up again */
+static int update_graph(void *arg)
+{
+	realign_requested = 1;
+	return 0;
+}
+
+
+/* Ask the main loop for a statistics report */
+static void request_report(int sig)
+{
+	report_requested = 1;
+}
+
+
+/* Add any new levels to the quantile sketches */
+static void update_history()
+{
+	float ms;
+
+	while (jack_ringbuffer_read_space( level_rb ) >= sizeof(ms)) {
+		jack_ringbuffer_read( level_rb, (char *) &ms, sizeof(ms) );
+		sketch_history_add( history, 10.0f * log10f(ms * bias * bias) );
+	}
+}
+
+
+/* Run the delay measurement and null test on everything from the compare port so far */
+static void update_delay()
+{
+	float pairs[COMPARE_CHUNK * 2];
+	size_t len;
+
+	while ((len = jack_ringbuffer_read( compare_rb, (char *) pairs, sizeof(pairs) )) > 0) {
+		const unsigned int nframes = len / (sizeof(float) * 2);
+
+		delay_add( delay, pairs, nframes );
+
+		// Only once the inputs have been lined up
+		if (null_test && delay->estimates && delay->confidence >= DELAY_MIN_CONFIDENCE) {
+			null_add( null_test, pairs, nframes, delay->delay, delay->inverted, stderr );
+		}
+	}
+}
+
+
+/* Run the THD+N measurement on everything from the input so far */
+static void update_thd(FILE *out)
+{
+	float samples[COMPARE_CHUNK];
+	size_t len;
+
+	while ((len = jack_ringbuffer_read( input_rb, (char *) samples, sizeof(samples) )) > 0) {
+		thd_add( thd, samples, len / sizeof(float), out );
+	}
+}
+
+
+/* Print a round trip measurement, next to what JACK thinks it should be */
+static void report_loopback()
+{
+	jack_latency_range_t capture, playback;
+	unsigned long latency;
+	float confidence;
+
+	if (!loopback_result( loopback, &latency, &confidence )) return;
+
+	if (confidence < 0.5f) {
+		fprintf(stderr, "Round trip: burst not found (confidence %1.0f%%)\n", 100.0f * confidence);
+		return;
+	}
+
+	jack_port_get_latency_range( input_port, JackCaptureLatency, &capture );
+	jack_port_get_latency_range( output_port, JackPlaybackLatency, &playback );
+
+	fprintf(stderr, "Round trip: %lu samples (%1.2fms), confidence %1.0f%%; JACK reports %u (capture %u + playback %u), difference %ld\n",
+		latency, 1000.0 * latency / jack_get_sample_rate( client ), 100.0f * confidence,
+		capture.max + playback.max, capture.max, playback.max,
+		(long) latency - (long) (capture.max + playback.max));
+}
+
+
 /*
 	db: the signal stength in db
 	width: the size of the meter
@@ -115,7 +646,7 @@ static int iec_scale(float db, int size) {
 static void cleanup()
 {
 	const char **all_ports;
-	unsigned int i;
+	unsigned int i, j, g;
 
 	fprintf(stderr,"cleanup()\n");
 
@@ -128,6 +659,62 @@ static void cleanup()
 		}
 	}
 
+	if (compare_port != NULL ) {
+
+		all_ports = jack_port_get_all_connections(client, compare_port);
+
+		for (i=0; all_ports && all_ports[i]; i++) {
+			jack_disconnect(client, all_ports[i], jack_port_name(compare_port));
+		}
+	}
+
+	if (output_port != NULL ) {
+
+		all_ports = jack_port_get_all_connections(client, output_port);
+
+		for (i=0; all_ports && all_ports[i]; i++) {
+			jack_disconnect(client, jack_port_name(output_port), all_ports[i]);
+		}
+	}
+
+	if (midi_port != NULL ) {
+
+		all_ports = jack_port_get_all_connections(client, midi_port);
+
+		for (i=0; all_ports && all_ports[i]; i++) {
+			jack_disconnect(client, jack_port_name(midi_port), all_ports[i]);
+		}
+	}
+
+	for (g=0; g<group_count; g++) {
+		for (j=0; j<groups[g]->channels; j++) {
+
+			all_ports = jack_port_get_all_connections(client, group_ports[g][j]);
+
+			for (i=0; all_ports && all_ports[i]; i++) {
+				jack_disconnect(client, all_ports[i], jack_port_name(group_ports[g][j]));
+			}
+		}
+	}
+
+	for (j=0; sources && j<sources->count; j++) {
+
+		all_ports = jack_port_get_all_connections(client, source_ports[j]);
+
+		for (i=0; all_ports && all_ports[i]; i++) {
+			jack_disconnect(client, all_ports[i], jack_port_name(source_ports[j]));
+		}
+	}
+
+	for (j=0; cv && j<cv->count; j++) {
+
+		all_ports = jack_port_get_all_connections(client, cv_ports[j]);
+
+		for (i=0; all_ports && all_ports[i]; i++) {
+			jack_disconnect(client, jack_port_name(cv_ports[j]), all_ports[i]);
+		}
+	}
+
 	/* Leave the jack graph */
 	jack_client_close(client);
 
@@ -135,7 +722,7 @@ static void cleanup()
 
 
 /* Connect the chosen port to ours */
-static void connect_port(jack_client_t *client, char *port_name)
+static void connect_port(jack_client_t *client, char *port_name, jack_port_t *to_port)
 {
 	jack_port_t *port;
 
@@ -147,14 +734,29 @@ static void connect_port(jack_client_t *client, char *port_name)
 	}
 
 	// Connect the port to our input port
-	fprintf(stderr,"Connecting '%s' to '%s'...\n", jack_port_name(port), jack_port_name(input_port));
-	if (jack_connect(client, jack_port_name(port), jack_port_name(input_port))) {
-		fprintf(stderr, "Cannot connect port '%s' to '%s'\n", jack_port_name(port), jack_port_name(input_port));
+	fprintf(stderr,"Connecting '%s' to '%s'...\n", jack_port_name(port), jack_port_name(to_port));
+	if (jack_connect(client, jack_port_name(port), jack_port_name(to_port))) {
+		fprintf(stderr, "Cannot connect port '%s' to '%s'\n", jack_port_name(port), jack_port_name(to_port));
 		exit(1);
 	}
 }
 
 
+/* Connect a port to the nth channel counting through all of the groups, if there is one */
+static void connect_group(jack_client_t *client, char *port_name, unsigned int n)
+{
+	unsigned int g;
+
+	for (g=0; g<group_count; g++) {
+		if (n < groups[g]->channels) {
+			connect_port( client, port_name, group_ports[g][n] );
+			return;
+		}
+		n -= groups[g]->channels;
+	}
+}
+
+
 /* Sleep for a fraction of a second */
 static int fsleep( float secs )
 {
@@ -165,22 +767,249 @@ static int fsleep( float secs )
 }
 
 
+/* Called by JACK when it starts or stops freewheeling, the process thread notices */
+static void update_freewheel(int starting, void *arg)
+{
+	freewheel = starting;
+}
+
+
+/* Print what was measured over a freewheel run */
+static void report_run()
+{
+	unsigned int g;
+
+	if (run_peak > 0.0f) {
+		fprintf(stderr, "Freewheel run: %1.1f seconds, peak %1.1f dB\n",
+			(double) run_frames / sample_rate, 20.0f * log10f(run_peak * bias));
+	} else {
+		fprintf(stderr, "Freewheel run: %1.1f seconds, peak -inf dB (no signal)\n",
+			(double) run_frames / sample_rate);
+	}
+	for (g=0; g<group_count; g++) {
+		if (run_true_peak[g] > 0.0f && isfinite( run_integrated[g] )) {
+			fprintf(stderr, "%s loudness of the run: integrated %1.1f LUFS, true peak %1.1f dBTP\n",
+				groups[g]->layout, run_integrated[g], 20.0f * log10f( run_true_peak[g] ));
+		} else if (run_true_peak[g] > 0.0f) {
+			fprintf(stderr, "%s loudness of the run: integrated -inf LUFS (below the gate), true peak %1.1f dBTP\n",
+				groups[g]->layout, 20.0f * log10f( run_true_peak[g] ));
+		} else {
+			fprintf(stderr, "%s loudness of the run: no signal\n", groups[g]->layout);
+		}
+	}
+}
+
+
+/* Called by JACK when the sample rate changes, the main loop does the work */
+static int update_sample_rate(jack_nframes_t nframes, void *arg)
+{
+	new_sample_rate = nframes;
+	return 0;
+}
+
+
+/* Called by JACK when the buffer size changes. The scratch buffers
+   are big enough for any size already, and the main loop does the rest */
+static int update_buffer_size(jack_nframes_t nframes, void *arg)
+{
+	new_buffer_size = nframes;
+	return 0;
+}
+
+
+/*
+	Build the meters that depend on the sample rate or buffer size
+	again, for the new ones. Each is built here, outside the process
+	thread, and swapped in with a single pointer store. The old ones
+	are kept until the process thread has finished a cycle, as it
+	could still be using them. Anything that fails to build is left as
+	it was. A new buffer size only changes the channel alignment; the
+	sliding windows move on in blocks of their own, and keep their
+	history. A new sample rate starts everything again, the sliding
+	windows and the round trip, sweep and THD+N measurements included.
+*/
+static void reconfigure()
+{
+	const jack_nframes_t fs = new_sample_rate;
+	const jack_nframes_t period = new_buffer_size;
+	const int rate_changed = (fs != sample_rate);
+	bands_t *old_bands = NULL;
+	weighting_t *old_weighting = NULL;
+	tones_t *old_tones = NULL;
+	noise_t *old_noise = NULL;
+	peaks_t *old_peaks = NULL;
+	leq_t *old_leq = NULL;
+	cv_t *old_cv = NULL;
+	midi_t *old_midi = NULL;
+	loopback_t *old_loopback = NULL;
+	sweep_t *old_sweep = NULL;
+	gen_t *old_gen = NULL;
+	thd_t *old_thd = NULL;
+	loudness_t *old_groups[GROUPS_MAX] = { NULL };
+	align_t *old_aligns[GROUPS_MAX] = { NULL };
+	unsigned long cycle;
+	unsigned int g;
+	int i;
+
+	fprintf(stderr, "Server changed to %u Hz, %u frames: rebuilding meters.\n", fs, period);
+
+	if (rate_changed && bands) {
+		bands_t *b = bands_new( bands_per_octave, fs );
+		if (b) { old_bands = bands; bands = b; }
+	}
+	if (rate_changed && weighting) {
+		weighting_t *w = weighting_new( weighting_type, fs );
+		if (w) { old_weighting = weighting; weighting = w; }
+	}
+	if (rate_changed && tones) {
+		tones_t *t = tones_new( fs );
+		int failed = (t == NULL);
+
+		if (!failed && hum_freq > 0.0f && tones_add_hum( t, hum_freq )) {
+			failed = 1;
+		}
+		for (i=0; !failed && i<lineup_count; i++) {
+			if (tones_add_lineup( t, lineup_freq[i], lineup_level[i] )) failed = 1;
+		}
+		if (failed) {
+			fprintf(stderr, "Can't detect the hum and line-up tones at %u Hz, keeping the old detector.\n", fs);
+			tones_free( t );
+		} else {
+			old_tones = tones;
+			tones = t;
+		}
+	}
+	if (rate_changed && noise) {
+		noise_t *n = noise_new( fs, noise_secs );
+		if (n) { old_noise = noise; noise = n; }
+	}
+	if (rate_changed && peaks) {
+		peaks_t *p = peaks_new( peak_windows, fs, WINDOW_BLOCK );
+		if (p) { old_peaks = peaks; peaks = p; }
+	}
+	if (rate_changed && leq) {
+		leq_t *l = leq_new( leq_windows, fs, WINDOW_BLOCK );
+		if (l) { old_leq = leq; leq = l; }
+	}
+	if (rate_changed && cv) {
+		cv_t *c = cv_new( cv_spec, fs, bias );
+		if (c) { old_cv = cv; cv = c; }
+	}
+	if (rate_changed && midi) {
+		midi_t *m = midi_new( midi_spec, fs, midi_rate, bias );
+		if (m) { old_midi = midi; midi = m; }
+	}
+	if (rate_changed && loopback) {
+		loopback_t *l = loopback_new( fs );
+		if (l) { old_loopback = loopback; loopback = l; }
+	}
+	if (rate_changed && sweep) {
+		sweep_t *sw = sweep_new( fs, SWEEP_SECS );
+		if (sw) { old_sweep = sweep; sweep = sw; }
+	}
+	if (rate_changed && gen) {
+		gen_t *gn = gen_new( gen_spec, fs, bias );
+		if (gn) { old_gen = gen; gen = gn; }
+	}
+	if (rate_changed && thd) {
+		thd_t *t = thd_new( fs, (gen && gen->type == GEN_TONE) ? gen->freq : 0.0 );
+		if (t) { old_thd = thd; thd = t; }
+	}
+	if (rate_changed && level_rb) {
+		level_len = fs * SKETCH_SECS;
+	}
+	if (rate_changed && metrics) {
+		metrics_set_samplerate( metrics, fs );
+	}
+	for (g=0; g<group_count; g++) {
+		if (rate_changed) {
+			loudness_t *l = loudness_new( group_layouts[g], fs );
+			if (l) { old_groups[g] = groups[g]; groups[g] = l; }
+		}
+		if (period <= ALIGN_MAX_FRAMES) {
+			align_t *a = align_new( groups[g]->channels, period );
+			if (a) { old_aligns[g] = aligns[g]; aligns[g] = a; }
+		}
+	}
+	if (group_count) {
+		align_groups();
+	}
+
+	sample_rate = fs;
+	buffer_size = period;
+
+	// Wait for the end of the cycle that might have the old ones. If
+	// none ends within a second, the process thread could still be part
+	// way through one, so the old ones are left allocated rather than freed
+	__sync_synchronize();
+	cycle = cycles;
+	for (i=0; i<100 && cycles == cycle; i++) {
+		fsleep( 0.01f );
+	}
+	if (cycles == cycle) {
+		fprintf(stderr, "No process cycle has finished, so the old meters are not freed.\n");
+		return;
+	}
+
+	bands_free( old_bands );
+	weighting_free( old_weighting );
+	tones_free( old_tones );
+	noise_free( old_noise );
+	peaks_free( old_peaks );
+	leq_free( old_leq );
+	cv_free( old_cv );
+	midi_free( old_midi );
+	loopback_free( old_loopback );
+	sweep_free( old_sweep );
+	gen_free( old_gen );
+	thd_free( old_thd );
+	for (g=0; g<group_count; g++) {
+		loudness_free( old_groups[g] );
+		align_free( old_aligns[g] );
+	}
+}
+
+
 /* Display how to use this program */
 static int usage( const char * progname )
 {
 	fprintf(stderr, "jackmeter version %s\n\n", VERSION);
-	fprintf(stderr, "Usage %s [-f freqency] [-r ref-level] [-w width] [-s servername] [-n] [<port>, ...]\n\n", progname);
+	fprintf(stderr, "Usage %s [-f freqency] [-r ref-level] [-w width] [-s servername] [-b bands] [-W weighting] [-H mains] [-t freq[:level]] [-N secs] [-P secs,...] [-L secs,...] [-Q] [-D] [-C port] [-X dB] [-l port] [-g signal] [-o port] [-S port] [-T] [-V envelope,...] [-M message] [-R rate] [-O [host]:port,...] [-E [host:]port] [-k output] [-G layout] [-p] [-n] [<port>, ...]\n\n", progname);
 	fprintf(stderr, "where  -f      is how often to update the meter per second [8]\n");
 	fprintf(stderr, "       -r      is the reference signal level for 0dB on the meter\n");
 	fprintf(stderr, "       -w      is how wide to make the meter [79]\n");
 	fprintf(stderr, "       -s      is the [optional] name given the jack server when it was started\n");
+	fprintf(stderr, "       -b      show band levels, 1 per octave or 3 per octave\n");
+	fprintf(stderr, "       -W      meter RMS level with A, C or Z frequency weighting\n");
+	fprintf(stderr, "       -H      report mains hum at this frequency (50 or 60) and its harmonics\n");
+	fprintf(stderr, "       -t      report line-up tone at this frequency and level [-18]\n");
+	fprintf(stderr, "       -N      report noise floor and SNR over this many seconds\n");
+	fprintf(stderr, "       -P      show the peak level over sliding windows of these lengths\n");
+	fprintf(stderr, "       -L      show the RMS level (Leq) over sliding windows of these lengths\n");
+	fprintf(stderr, "       -Q      keep level quantiles, reported on SIGUSR1\n");
+	fprintf(stderr, "       -D      keep a histogram of sample levels, reported on SIGUSR1\n");
+	fprintf(stderr, "       -C      measure the delay of this port relative to the metered port(s)\n");
+	fprintf(stderr, "       -X      null test against the -C port, alarm if the difference is above dB\n");
+	fprintf(stderr, "       -l      play bursts to this port and measure the round trip back to the input\n");
+	fprintf(stderr, "       -g      generate tone[:freq][:level], pink[:level], sweep[:level] or ident[:freq][:level]\n");
+	fprintf(stderr, "       -o      the port to connect the generator to\n");
+	fprintf(stderr, "       -S      play sweeps to this port and plot the frequency response back to the input\n");
+	fprintf(stderr, "       -T      measure THD+N of the tone on the input (or from -g tone)\n");
+	fprintf(stderr, "       -V      output peak or rms[:block] level envelopes on ports of the same name\n");
+	fprintf(stderr, "       -M      send levels on a MIDI port as cc[:channel[:controller]] or mackie[:strip]\n");
+	fprintf(stderr, "       -R      how many MIDI messages to send per second [%g]\n", MIDI_RATE);
+	fprintf(stderr, "       -O      send OSC level messages over UDP to these addresses\n");
+	fprintf(stderr, "       -E      serve OpenMetrics statistics over HTTP on this port\n");
+	fprintf(stderr, "       -k      output to terminal, numeric, ndjson:file, udp:host:port, shm:name or alert:dB, each [@rate]\n");
+	fprintf(stderr, "       -G      report loudness of a 2.0, 5.1, 7.1 or 7.1.4 group of the ports, in order\n");
+	fprintf(stderr, "       -p      give each port an input of its own and show its level as well as the mix\n");
 	fprintf(stderr, "       -n      changes mode to output meter level as number in decibels\n");
 	fprintf(stderr, "       <port>  the port(s) to monitor (multiple ports are mixed)\n");
 	exit(1);
 }
 
 
-void display_scale( int width )
+void display_scale( int indent, int width )
 {
 	int i=0;
 	const int marks[11] = { 0, -5, -10, -15, -20, -25, -30, -35, -40, -50, -60 };
@@ -215,8 +1044,8 @@ void display_scale( int width )
 	}
 	
 	// Print it to screen
-	printf("%s\n", scale);
-	printf("%s\n", line);
+	printf("%*s%s\n", indent, "", scale);
+	printf("%*s%s\n", indent, "", line);
 	free(scale);
 	free(line);
 }
@@ -250,20 +1079,114 @@ void display_meter( int db, int width )
 }
 
 
+/* Draw one bar per band, leaving the cursor on the line below the last one */
+void display_bands( const float *db, int width )
+{
+	unsigned int b;
+	int i;
+
+	for(b=0; b<bands->count; b++) {
+		int size = iec_scale( db[b], width-6 );
+
+		printf("\r%5s ", bands->label[b]);
+		for(i=0; i<size; i++) { printf("#"); }
+		for(i=size; i<width-6; i++) { printf(" "); }
+		printf("\n");
+	}
+}
+
+
+/* Draw the levels of some sliding windows on one line */
+void display_windows( const char *name, const float *secs, const float *db, unsigned int count, int width )
+{
+	int len = printf("\r%s", name);
+	unsigned int w;
+
+	for(w=0; w<count && len < width; w++) {
+		len += printf(" %gs: %1.1f ", secs[w], db[w]);
+	}
+	printf("\033[K");
+}
+
+
+/* Draw the peak level of each source on one line */
+void display_sources( const char * const *name, const float *db, unsigned int count, int width )
+{
+	int len = printf("\rsrc");
+	unsigned int s;
+
+	for(s=0; s<count && len < width; s++) {
+		len += printf(" %s: %1.1f ", name[s], db[s]);
+	}
+	printf("\033[K");
+}
+
+
+/* The bar graph display, as a sink */
+static void display_frame( sink_t *sink, const sink_frame_t *frame )
+{
+	int lines = 0, fresh_line = 0;
+
+	if (frame->band_count) {
+		display_bands( frame->band_db, console_width );
+		lines = frame->band_count;
+		fresh_line = 1;
+	} else {
+		display_meter( frame->db, console_width );
+	}
+
+	// Extra lines below the meter, then back up to the top
+	if (frame->peak_count) {
+		if (!fresh_line) { printf("\n"); lines++; }
+		display_windows( "max", frame->peak_secs, frame->peak_db, frame->peak_count, console_width );
+		fresh_line = 0;
+	}
+	if (frame->leq_count) {
+		if (!fresh_line) { printf("\n"); lines++; }
+		display_windows( "Leq", frame->leq_secs, frame->leq_db, frame->leq_count, console_width );
+		fresh_line = 0;
+	}
+	if (frame->source_count) {
+		if (!fresh_line) { printf("\n"); lines++; }
+		display_sources( frame->source_name, frame->source_db, frame->source_count, console_width );
+		fresh_line = 0;
+	}
+	if (lines) printf("\033[%dA", lines);
+}
+
+
 int main(int argc, char *argv[])
 {
-	int console_width = 79;
 	jack_status_t status;
 	int running = 1;
 	float ref_lev;
 	int decibels_mode = 0;
+	const char *sink_specs[SINK_MAX];
+	int sink_count = 0;
+	int terminal = 0;
+	unsigned long seq = 0;
+	unsigned int group_channels = 0;
+	int source_mode = 0;
+	int freewheel_shown = 0;
+	int quantiles = 0;
+	int histogram = 0;
+	char *compare_name = NULL;
+	float null_threshold = 0.0f;
+	int null_mode = 0;
+	char *loopback_name = NULL;
+	char *sweep_name = NULL;
+	char *osc_spec = NULL;
+	char *metrics_spec = NULL;
+	char *output_name = NULL;
+	int thd_mode = 0;
 	int rate = 8;
-	int opt;
+	int opt, i;
+	unsigned int g;
 
 	// Make STDOUT unbuffered
 	setbuf(stdout, NULL);
 
-	while ((opt = getopt(argc, argv, "s:w:f:r:nhv")) != -1) {
+	while ((opt = getopt(argc, argv, "s:w:f:r:b:W:H:t:N:P:L:QDC:X:l:g:o:S:TV:M:R:O:E:k:G:pnhv")) != -1) {
 		switch (opt) {
 			case 's':
 				server_name = (char *) malloc (sizeof (char) * strlen(optarg));
@@ -286,6 +1209,101 @@ int main(int argc, char *argv[])
 			case 'n':
 				decibels_mode = 1;
 				break;
+			case 'b':
+				bands_per_octave = atoi(optarg);
+				if (bands_per_octave != 1 && bands_per_octave != 3) {
+					fprintf(stderr,"Bands per octave must be 1 or 3.\n");
+					exit(1);
+				}
+				break;
+			case 'W':
+				weighting_type = toupper(optarg[0]);
+				if (strchr("ACZ", weighting_type) == NULL || optarg[1]) {
+					fprintf(stderr,"Weighting must be A, C or Z.\n");
+					exit(1);
+				}
+				break;
+			case 'H':
+				hum_freq = atof(optarg);
+				break;
+			case 't':
+				if (lineup_count >= TONES_MAX - TONES_HUM_LANES) {
+					fprintf(stderr,"Too many line-up tones.\n");
+					exit(1);
+				}
+				lineup_freq[lineup_count] = atof(optarg);
+				lineup_level[lineup_count] = strchr(optarg, ':') ? atof(strchr(optarg, ':')+1) : -18.0f;
+				lineup_count++;
+				break;
+			case 'N':
+				noise_secs = atof(optarg);
+				break;
+			case 'P':
+				peak_windows = optarg;
+				break;
+			case 'L':
+				leq_windows = optarg;
+				break;
+			case 'Q':
+				quantiles = 1;
+				break;
+			case 'D':
+				histogram = 1;
+				break;
+			case 'C':
+				compare_name = optarg;
+				break;
+			case 'X':
+				null_threshold = atof(optarg);
+				null_mode = 1;
+				break;
+			case 'l':
+				loopback_name = optarg;
+				break;
+			case 'g':
+				gen_spec = optarg;
+				break;
+			case 'o':
+				output_name = optarg;
+				break;
+			case 'S':
+				sweep_name = optarg;
+				break;
+			case 'T':
+				thd_mode = 1;
+				break;
+			case 'V':
+				cv_spec = optarg;
+				break;
+			case 'M':
+				midi_spec = optarg;
+				break;
+			case 'R':
+				midi_rate = atof(optarg);
+				break;
+			case 'O':
+				osc_spec = optarg;
+				break;
+			case 'E':
+				metrics_spec = optarg;
+				break;
+			case 'k':
+				if (sink_count >= SINK_MAX) {
+					fprintf(stderr,"Too many outputs.\n");
+					exit(1);
+				}
+				sink_specs[sink_count++] = optarg;
+				break;
+			case 'G':
+				if (group_count >= GROUPS_MAX) {
+					fprintf(stderr,"Too many channel groups.\n");
+					exit(1);
+				}
+				group_layouts[group_count++] = optarg;
+				break;
+			case 'p':
+				source_mode = 1;
+				break;
 			case 'h':
 			case 'v':
 			default:
@@ -309,12 +1327,321 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "Cannot register input port 'meter'.\n");
 		exit(1);
 	}
+
+	// Our copy of the input, for after JACK has been signalled
+	input_copy = malloc( sizeof(float) * PERIOD_MAX );
+	if (input_copy == NULL) {
+		fprintf(stderr, "Failed to create input buffer.\n");
+		exit(1);
+	}
 	
+	// Create the band filters for the server's sample rate
+	if (bands_per_octave) {
+		bands = bands_new( bands_per_octave, jack_get_sample_rate( client ) );
+		if (bands == NULL) {
+			fprintf(stderr, "Failed to create band filters.\n");
+			exit(1);
+		}
+		fprintf(stderr,"Band filters: %u bands from %sHz to %sHz\n",
+			bands->count, bands->label[0], bands->label[bands->count-1]);
+	}
+
+	// Create the weighting filter and its scratch buffer
+	if (weighting_type) {
+		weighting = weighting_new( weighting_type, jack_get_sample_rate( client ) );
+		weighted = malloc( sizeof(float) * PERIOD_MAX );
+		if (weighting == NULL || weighted == NULL) {
+			fprintf(stderr, "Failed to create weighting filter.\n");
+			exit(1);
+		}
+		fprintf(stderr,"Metering %c-weighted RMS level.\n", weighting_type);
+	}
+
+	// Create the Goertzel filters for hum and tone detection
+	if (hum_freq > 0.0f || lineup_count) {
+		tones = tones_new( jack_get_sample_rate( client ) );
+		if (tones == NULL) {
+			fprintf(stderr, "Failed to create tone detector.\n");
+			exit(1);
+		}
+		if (hum_freq > 0.0f && tones_add_hum( tones, hum_freq )) {
+			fprintf(stderr, "Invalid mains frequency: %g\n", hum_freq);
+			exit(1);
+		}
+		for (i=0; i<lineup_count; i++) {
+			if (tones_add_lineup( tones, lineup_freq[i], lineup_level[i] )) {
+				fprintf(stderr, "Invalid line-up tone frequency: %g\n", lineup_freq[i]);
+				exit(1);
+			}
+		}
+	}
+
+	// Create the noise floor tracker
+	if (noise_secs > 0.0f) {
+		noise = noise_new( jack_get_sample_rate( client ), noise_secs );
+		if (noise == NULL) {
+			fprintf(stderr, "Failed to create noise floor tracker.\n");
+			exit(1);
+		}
+	}
+
+	// Create the sliding window peak meters
+	if (peak_windows) {
+		peaks = peaks_new( peak_windows, jack_get_sample_rate( client ), WINDOW_BLOCK );
+		if (peaks == NULL) {
+			fprintf(stderr, "Invalid peak windows: %s\n", peak_windows);
+			exit(1);
+		}
+	}
+
+	// Create the sliding window Leq meters
+	if (leq_windows) {
+		leq = leq_new( leq_windows, jack_get_sample_rate( client ), WINDOW_BLOCK );
+		if (leq == NULL) {
+			fprintf(stderr, "Invalid Leq windows: %s\n", leq_windows);
+			exit(1);
+		}
+	}
+
+	// Create the quantile sketches, fed once a second from the process callback
+	if (quantiles) {
+		level_len = jack_get_sample_rate( client ) * SKETCH_SECS;
+		level_rb = jack_ringbuffer_create( 64 * sizeof(float) );
+		history = sketch_history_new();
+		if (level_rb == NULL || history == NULL) {
+			fprintf(stderr, "Failed to create level quantile sketches.\n");
+			exit(1);
+		}
+	}
+
+	// Create the sample level histogram
+	if (histogram) {
+		hist = hist_new();
+		if (hist == NULL) {
+			fprintf(stderr, "Failed to create level histogram.\n");
+			exit(1);
+		}
+	}
+
+	// Reports are printed when asked for
+	if (history || hist) {
+		signal( SIGUSR1, request_report );
+	}
+
+	// Create the second input, and the cross-correlation for the delay to it
+	if (compare_name) {
+		if (!(compare_port = jack_port_register(client, "compare", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+			fprintf(stderr, "Cannot register input port 'compare'.\n");
+			exit(1);
+		}
+		compare_pairs = malloc( sizeof(float) * PERIOD_MAX * 2 );
+		compare_rb = jack_ringbuffer_create( sizeof(float) * 2 * jack_get_sample_rate( client ) * 2 );
+		delay = delay_new( DELAY_FFT_SIZE );
+		if (compare_pairs == NULL || compare_rb == NULL || delay == NULL) {
+			fprintf(stderr, "Failed to create delay measurement.\n");
+			exit(1);
+		}
+	}
+
+	// Create the null test, which relies on the delay measurement
+	if (null_mode) {
+		if (delay == NULL) {
+			fprintf(stderr, "The null test needs a port to compare with (-C).\n");
+			exit(1);
+		}
+		null_test = null_new( DELAY_MAX, COMPARE_CHUNK, jack_get_sample_rate( client ), null_threshold );
+		if (null_test == NULL) {
+			fprintf(stderr, "Failed to create null test.\n");
+			exit(1);
+		}
+	}
+
+	// Create the output port for the round trip measurement, generator or sweep
+	if (!!loopback_name + !!gen_spec + !!sweep_name > 1) {
+		fprintf(stderr, "Only one of the generator, round trip and sweep measurements can use the output port.\n");
+		exit(1);
+	}
+	if (output_name && !gen_spec) {
+		fprintf(stderr, "There is no generator (-g) to connect to '%s'.\n", output_name);
+		exit(1);
+	}
+	if (loopback_name || gen_spec || sweep_name) {
+		if (!(output_port = jack_port_register(client, "out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
+			fprintf(stderr, "Cannot register output port 'out'.\n");
+			exit(1);
+		}
+	}
+	if (loopback_name) {
+		loopback = loopback_new( jack_get_sample_rate( client ) );
+		if (loopback == NULL) {
+			fprintf(stderr, "Failed to create round trip measurement.\n");
+			exit(1);
+		}
+	}
+
+	if (sweep_name) {
+		sweep = sweep_new( jack_get_sample_rate( client ), SWEEP_SECS );
+		if (sweep == NULL) {
+			fprintf(stderr, "Failed to create sweep measurement.\n");
+			exit(1);
+		}
+	}
+
+	// Create the generator, after -r so that its level matches the meter
+	if (gen_spec) {
+		gen = gen_new( gen_spec, jack_get_sample_rate( client ), bias );
+		if (gen == NULL) {
+			fprintf(stderr, "Invalid generator signal: %s\n", gen_spec);
+			exit(1);
+		}
+	}
+
+	// Create the THD+N measurement, locked to our own tone if there is one
+	if (thd_mode) {
+		thd = thd_new( jack_get_sample_rate( client ), (gen && gen->type == GEN_TONE) ? gen->freq : 0.0 );
+		input_rb = jack_ringbuffer_create( sizeof(float) * jack_get_sample_rate( client ) * 2 );
+		if (thd == NULL || input_rb == NULL) {
+			fprintf(stderr, "Failed to create THD+N measurement.\n");
+			exit(1);
+		}
+	}
+
+	// Create the level envelope outputs
+	if (cv_spec) {
+		cv = cv_new( cv_spec, jack_get_sample_rate( client ), bias );
+		if (cv == NULL) {
+			fprintf(stderr, "Invalid level envelopes: %s\n", cv_spec);
+			exit(1);
+		}
+		for (i=0; i<cv->count; i++) {
+			if (!(cv_ports[i] = jack_port_register(client, cv->name[i], JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
+				fprintf(stderr, "Cannot register output port '%s'.\n", cv->name[i]);
+				exit(1);
+			}
+		}
+	}
+
+	// Create the MIDI level output
+	if (midi_spec) {
+		midi = midi_new( midi_spec, jack_get_sample_rate( client ), midi_rate, bias );
+		if (midi == NULL) {
+			fprintf(stderr, "Invalid MIDI level messages: %s\n", midi_spec);
+			exit(1);
+		}
+		if (!(midi_port = jack_port_register(client, "midi", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))) {
+			fprintf(stderr, "Cannot register output port 'midi'.\n");
+			exit(1);
+		}
+	}
+
+	// Start sending OSC level messages
+	if (osc_spec) {
+		osc = osc_new( osc_spec, jack_get_sample_rate( client ), PERIOD_MIN, bias );
+		if (osc == NULL) {
+			fprintf(stderr, "Failed to start OSC level messages to: %s\n", osc_spec);
+			exit(1);
+		}
+	}
+
+	// Start serving statistics
+	if (metrics_spec) {
+		metrics = metrics_new( metrics_spec, jack_get_sample_rate( client ), bias );
+		if (metrics == NULL) {
+			fprintf(stderr, "Failed to serve statistics on: %s\n", metrics_spec);
+			exit(1);
+		}
+		jack_set_xrun_callback(client, count_xrun, 0);
+	}
+
+	// Create the channel groups, with a port for each channel
+	for (g=0; g<group_count; g++) {
+		groups[g] = loudness_new( group_layouts[g], jack_get_sample_rate( client ) );
+		if (groups[g] == NULL) {
+			fprintf(stderr, "Invalid channel group: %s\n", group_layouts[g]);
+			exit(1);
+		}
+		for (i=0; i<groups[g]->channels; i++) {
+			char name[32];
+
+			snprintf( name, sizeof(name), "g%u_%s", g+1, groups[g]->name[i] );
+			if (!(group_ports[g][i] = jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+				fprintf(stderr, "Cannot register input port '%s'.\n", name);
+				exit(1);
+			}
+			group_copy[g][i] = malloc( sizeof(float) * PERIOD_MAX );
+			if (group_copy[g][i] == NULL) {
+				fprintf(stderr, "Failed to create channel group buffers.\n");
+				exit(1);
+			}
+		}
+		group_channels += groups[g]->channels;
+
+		aligns[g] = align_new( groups[g]->channels, jack_get_buffer_size( client ) );
+		if (aligns[g] == NULL) {
+			fprintf(stderr, "Failed to create channel alignment.\n");
+			exit(1);
+		}
+	}
+	if (group_count) {
+		jack_set_graph_order_callback(client, update_graph, 0);
+	}
+
+	// Create an input for each source, to mix here instead of in "in"
+	if (source_mode) {
+		sources = sources_new( PERIOD_MAX );
+		if (sources == NULL) {
+			fprintf(stderr, "Failed to create source inputs.\n");
+			exit(1);
+		}
+		for (i=optind; i<argc; i++) {
+			char name[32];
+
+			snprintf( name, sizeof(name), "src%u", sources->count+1 );
+			if (sources_add( sources, argv[i] )) {
+				fprintf(stderr, "Too many sources.\n");
+				exit(1);
+			}
+			if (!(source_ports[sources->count-1] = jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+				fprintf(stderr, "Cannot register input port '%s'.\n", name);
+				exit(1);
+			}
+		}
+	}
+
+	// Set up the outputs: the bar graph or -n numbers, unless others are asked for
+	sinks = sinks_new();
+	if (sinks == NULL) {
+		fprintf(stderr, "Failed to create outputs.\n");
+		exit(1);
+	}
+	if (sink_count == 0 && !decibels_mode) {
+		sink_specs[sink_count++] = "terminal";
+	}
+	if (decibels_mode) {
+		sinks_add( sinks, "numeric", rate );
+	}
+	for (i=0; i<sink_count; i++) {
+		if (strcmp( sink_specs[i], "terminal" ) == 0) {
+			sinks_add_writer( sinks, display_frame );
+			terminal = 1;
+		} else if (sinks_add( sinks, sink_specs[i], rate )) {
+			fprintf(stderr, "Invalid output: %s\n", sink_specs[i]);
+			exit(1);
+		}
+	}
+
 	// Register the cleanup function to be called when program exits
 	atexit( cleanup );
 
-	// Register the peak signal callback
-	jack_set_process_callback(client, process_peak, 0);
+	// Start our process thread
+	jack_set_process_thread(client, process_thread, 0);
+
+	// The meters are rebuilt if the server's sample rate or buffer size changes
+	sample_rate = new_sample_rate = jack_get_sample_rate( client );
+	buffer_size = new_buffer_size = jack_get_buffer_size( client );
+	jack_set_sample_rate_callback(client, update_sample_rate, 0);
+	jack_set_buffer_size_callback(client, update_buffer_size, 0);
+	jack_set_freewheel_callback(client, update_freewheel, 0);
 
 
 	if (jack_activate(client)) {
@@ -325,32 +1652,168 @@ int main(int argc, char *argv[])
 
 	// Connect our port to specified port(s)
 	if (argc > optind) {
+		unsigned int n = 0;
+
+		// As well as the mix, each port goes to the next channel of the groups
 		while (argc > optind) {
-			connect_port( client, argv[ optind ] );
+			connect_port( client, argv[ optind ], sources ? source_ports[n] : input_port );
+			connect_group( client, argv[ optind ], n++ );
 			optind++;
 		}
+		if (n < group_channels) {
+			fprintf(stderr,"Only %u of the %u channel group ports are connected.\n", n, group_channels);
+		}
+		align_groups();
 	} else {
 		fprintf(stderr,"Meter is not connected to a port.\n");
 	}
+	if (compare_name) {
+		connect_port( client, compare_name, compare_port );
+	}
+	if (loopback_name) {
+		output_name = loopback_name;
+	}
+	if (sweep_name) {
+		output_name = sweep_name;
+	}
+	if (output_name && output_port) {
+		fprintf(stderr,"Connecting '%s' to '%s'...\n", jack_port_name(output_port), output_name);
+		if (jack_connect(client, jack_port_name(output_port), output_name)) {
+			fprintf(stderr, "Cannot connect port '%s' to '%s'\n", jack_port_name(output_port), output_name);
+			exit(1);
+		}
+	}
 
 	// Calculate the decay length (should be 1600ms)
 	decay_len = (int)(1.6f / (1.0f/rate));
 	
 
 	// Display the scale
-	if (decibels_mode==0) {
-		display_scale( console_width );
+	if (terminal) {
+		display_scale( bands ? 6 : 0, bands ? console_width-6 : console_width );
 	}
 
 	while (running) {
-		float db = 20.0f * log10f(read_peak() * bias);
-		
-		if (decibels_mode==1) {
-			printf("%1.1f\n", db);
-		} else {
-			display_meter( db, console_width );
+		sink_frame_t frame;
+		struct timeval now;
+		unsigned int w;
+
+		if (new_sample_rate != sample_rate || new_buffer_size != buffer_size) {
+			reconfigure();
 		}
+
+		// Faster than real time, so there is no point in showing the
+		// levels; just keep up with what the process thread hands over.
+		// THD+N would report every block, so it measures quietly
+		if (freewheel) {
+			if (!freewheel_shown) {
+				fprintf(stderr, "Freewheeling: the levels will be reported at the end.\n");
+				freewheel_shown = 1;
+			}
+			if (history) {
+				update_history();
+			}
+			if (delay) {
+				update_delay();
+			}
+			if (thd) {
+				update_thd( NULL );
+			}
+			fsleep( FREEWHEEL_POLL );
+			continue;
+		}
+		freewheel_shown = 0;
+
+		// Latencies can change without the graph changing, so look once a second too
+		if (group_count && (realign_requested || seq % rate == 0)) {
+			realign_requested = 0;
+			align_groups();
+		}
+
+		if (run_done) {
+			run_done = 0;
+			report_run();
+		}
+
+		gettimeofday( &now, NULL );
+		frame.seq = seq++;
+		frame.time = now.tv_sec + now.tv_usec * 1e-6;
+		frame.weighting = weighting_type;
+		frame.db = 20.0f * log10f(read_peak() * bias);
+		if (weighting) {
+			frame.db = 10.0f * log10f(read_ms() * bias * bias);
+		}
+
+		frame.band_count = 0;
+		if (bands) {
+			bands_read( bands, bias, frame.band_db );
+			frame.band_count = bands->count;
+			frame.band_label = bands->label;
+		}
+
+		frame.peak_count = 0;
+		if (peaks) {
+			for (w=0; w<peaks->count; w++) {
+				frame.peak_db[w] = 20.0f * log10f(peaks->max[w] * bias);
+			}
+			frame.peak_count = peaks->count;
+			frame.peak_secs = peaks->secs;
+		}
+
+		frame.leq_count = 0;
+		if (leq) {
+			for (w=0; w<leq->count; w++) {
+				frame.leq_db[w] = 10.0f * log10f(leq->ms[w] * bias * bias);
+			}
+			frame.leq_count = leq->count;
+			frame.leq_secs = leq->secs;
+		}
+
+		frame.source_count = 0;
+		if (sources) {
+			sources_read( sources, bias, frame.source_db );
+			frame.source_count = sources->count;
+			frame.source_name = sources->name;
+		}
+
+		sinks_write( sinks, &frame );
 		
+		if (tones) {
+			tones_report( tones, bias, stderr );
+		}
+		if (noise) {
+			noise_report( noise, bias, stderr );
+		}
+		for (g=0; g<group_count; g++) {
+			loudness_report( groups[g], stderr );
+		}
+		if (history) {
+			update_history();
+		}
+		if (loopback) {
+			report_loopback();
+		}
+		if (delay) {
+			update_delay();
+			delay_report( delay, jack_get_sample_rate( client ), stderr );
+		}
+		if (thd) {
+			update_thd( stderr );
+		}
+		if (sweep) {
+			sweep_analyse( sweep, console_width, stderr );
+		}
+
+		if (report_requested) {
+			report_requested = 0;
+			if (history) {
+				sketch_history_report( history, stderr );
+			}
+			if (hist) {
+				hist_report( hist, bias, stderr );
+			}
+		}
+
 		fsleep( 1.0f/rate );
 	}
 
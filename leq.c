@@ -0,0 +1,99 @@
+/*
+
+	leq.c
+	Sliding window RMS and Leq levels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "leq.h"
+#include "window.h"
+
+
+leq_t *leq_new( const char *spec, double samplerate, unsigned int block )
+{
+	leq_t *leq = calloc( 1, sizeof(leq_t) );
+	unsigned int w;
+	int count;
+
+	if (leq == NULL) return NULL;
+
+	count = parse_windows( spec, leq->secs, LEQ_MAX );
+	if (count < 0) {
+		leq_free( leq );
+		return NULL;
+	}
+	leq->count = count;
+
+	// Windows are a whole number of blocks, rounded up
+	for (w=0; w < leq->count; w++) {
+		leq->blocks[w] = (unsigned int) ceil( leq->secs[w] * samplerate / block );
+		if (leq->blocks[w] > leq->size) leq->size = leq->blocks[w];
+	}
+
+	leq->ring = calloc( leq->size, sizeof(double) );
+	if (leq->ring == NULL) {
+		leq_free( leq );
+		return NULL;
+	}
+
+	return leq;
+}
+
+
+/* Called from the JACK process callback, once per block */
+void leq_push( leq_t *leq, double block_ms )
+{
+	unsigned int w;
+
+	leq->pushed++;
+
+	for (w=0; w < leq->count; w++) {
+		const unsigned int blocks = leq->blocks[w];
+
+		// Read the leaving block before the ring slot is reused
+		if (leq->pushed > blocks) {
+			leq->sum[w] -= leq->ring[ (leq->pos + leq->size - blocks) % leq->size ];
+		}
+		leq->sum[w] += block_ms;
+
+		leq->fresh[w] += block_ms;
+		if (++leq->fresh_count[w] == blocks) {
+			leq->sum[w] = leq->fresh[w];
+			leq->fresh[w] = 0.0;
+			leq->fresh_count[w] = 0;
+		}
+
+		leq->ms[w] = leq->sum[w] / (leq->pushed < blocks ? leq->pushed : blocks);
+	}
+
+	leq->ring[leq->pos] = block_ms;
+	leq->pos = (leq->pos + 1) % leq->size;
+}
+
+
+void leq_free( leq_t *leq )
+{
+	if (leq == NULL) return;
+
+	free( leq->ring );
+	free( leq );
+}
@@ -0,0 +1,64 @@
+/*
+
+	leq.h
+	Sliding window RMS and Leq levels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _LEQ_H_
+#define _LEQ_H_
+
+
+#define LEQ_MAX		8
+
+
+/*
+	The mean square of each block is kept in a ring as long as the
+	longest window, and every window has a running sum which adds
+	the new block and subtracts the one that has just left it.
+
+	To stop rounding errors building up over a long run, each window
+	also sums up its blocks afresh from empty, and when that has
+	covered a whole window it replaces the running sum.
+*/
+typedef struct {
+	unsigned int count;
+	float secs[LEQ_MAX];
+	unsigned int blocks[LEQ_MAX];
+
+	unsigned int size;
+	unsigned int pos;
+	unsigned long pushed;
+	double *ring;
+
+	double sum[LEQ_MAX];
+	double fresh[LEQ_MAX];
+	unsigned int fresh_count[LEQ_MAX];
+
+	/* Mean square of each window, published by the process callback */
+	double ms[LEQ_MAX];
+} leq_t;
+
+
+/* spec is a comma separated list of window lengths in seconds */
+leq_t *leq_new( const char *spec, double samplerate, unsigned int block );
+void leq_push( leq_t *leq, double block_ms );
+void leq_free( leq_t *leq );
+
+
+#endif
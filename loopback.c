@@ -0,0 +1,179 @@
+/*
+
+	loopback.c
+	Round-trip latency measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "loopback.h"
+
+
+loopback_t *loopback_new( double samplerate )
+{
+	loopback_t *lb = calloc( 1, sizeof(loopback_t) );
+	const float level = powf( 10.0f, LOOPBACK_LEVEL * 0.05f );
+	unsigned int reg = 1, i;
+
+	if (lb == NULL) return NULL;
+
+	lb->capture_len = (unsigned long)(samplerate * LOOPBACK_MAX_SECS) + LOOPBACK_MLS_LEN;
+	lb->capture = calloc( lb->capture_len, sizeof(float) );
+	if (lb->capture == NULL) {
+		free( lb );
+		return NULL;
+	}
+	lb->interval = (unsigned long)(samplerate * LOOPBACK_INTERVAL_SECS);
+
+	// Fibonacci LFSR for x^10 + x^7 + 1
+	for (i=0; i < LOOPBACK_MLS_LEN; i++) {
+		const unsigned int bit = ((reg >> 9) ^ (reg >> 6)) & 1;
+		lb->mls[i] = (reg & 1) ? level : -level;
+		reg = ((reg << 1) | bit) & LOOPBACK_MLS_LEN;
+	}
+
+	return lb;
+}
+
+
+/* Find where the burst starts to arrive, and search around there */
+static void loopback_onset( loopback_t *lb )
+{
+	const unsigned long last = lb->capture_len - LOOPBACK_MLS_LEN;
+	float peak = 0.0f;
+	unsigned long i, onset = 0;
+
+	for (i=0; i < lb->capture_len; i++) {
+		const float s = fabsf( lb->capture[i] );
+		if (s > peak) peak = s;
+	}
+	for (i=0; i < lb->capture_len; i++) {
+		if (fabsf( lb->capture[i] ) > peak * 0.5f) {
+			onset = i;
+			break;
+		}
+	}
+
+	lb->lag = (onset > LOOPBACK_SEARCH) ? onset - LOOPBACK_SEARCH : 0;
+	lb->lag_end = (onset + LOOPBACK_SEARCH < last) ? onset + LOOPBACK_SEARCH : last;
+	lb->best = 0.0f;
+	lb->best_lag = lb->lag;
+}
+
+
+/* Correlate the next few lags, and publish the result after the last */
+static void loopback_search( loopback_t *lb )
+{
+	unsigned int n;
+
+	for (n=0; n < LOOPBACK_LAGS_PER_CYCLE && lb->lag <= lb->lag_end; n++, lb->lag++) {
+		const float *cap = lb->capture + lb->lag;
+		float sum = 0.0f;
+		unsigned int j;
+
+		for (j=0; j < LOOPBACK_MLS_LEN; j++) {
+			sum += lb->mls[j] * cap[j];
+		}
+		if (fabsf( sum ) > fabsf( lb->best )) {
+			lb->best = sum;
+			lb->best_lag = lb->lag;
+		}
+	}
+
+	if (lb->lag > lb->lag_end) {
+		const float *cap = lb->capture + lb->best_lag;
+		float mls_energy = 0.0f, cap_energy = 0.0f;
+		unsigned int j;
+
+		for (j=0; j < LOOPBACK_MLS_LEN; j++) {
+			mls_energy += lb->mls[j] * lb->mls[j];
+			cap_energy += cap[j] * cap[j];
+		}
+
+		lb->latency = lb->best_lag;
+		lb->confidence = (cap_energy > 0.0f) ? fabsf( lb->best ) / sqrtf( mls_energy * cap_energy ) : 0.0f;
+		lb->seq++;
+
+		lb->state = LOOPBACK_IDLE;
+		lb->count = 0;
+	}
+}
+
+
+/* Called from the process thread before JACK is signalled: play the burst and record */
+void loopback_process( loopback_t *lb, const float *in, float *out, unsigned int nframes )
+{
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		float o = 0.0f;
+
+		if (lb->state == LOOPBACK_IDLE && ++lb->count >= lb->interval) {
+			lb->state = LOOPBACK_CAPTURE;
+			lb->count = 0;
+		}
+
+		// Sample 0 of the recording is the same frame as sample 0 of the burst
+		if (lb->state == LOOPBACK_CAPTURE) {
+			if (lb->count < LOOPBACK_MLS_LEN) o = lb->mls[lb->count];
+			lb->capture[lb->count] = in[i];
+			if (++lb->count >= lb->capture_len) {
+				lb->state = LOOPBACK_SEARCH_ONSET;
+			}
+		}
+
+		out[i] = o;
+	}
+}
+
+
+/* Called from the process thread after JACK is signalled: search the recording */
+void loopback_analyse( loopback_t *lb )
+{
+	if (lb->state == LOOPBACK_SEARCH_ONSET) {
+		loopback_onset( lb );
+		lb->state = LOOPBACK_SEARCH_PEAK;
+	} else if (lb->state == LOOPBACK_SEARCH_PEAK) {
+		loopback_search( lb );
+	}
+}
+
+
+/* Returns non-zero if there has been a new measurement since last time */
+int loopback_result( loopback_t *lb, unsigned long *latency, float *confidence )
+{
+	if (lb->seen == lb->seq) return 0;
+	lb->seen = lb->seq;
+
+	*latency = lb->latency;
+	*confidence = lb->confidence;
+
+	return 1;
+}
+
+
+void loopback_free( loopback_t *lb )
+{
+	if (lb == NULL) return;
+
+	free( lb->capture );
+	free( lb );
+}
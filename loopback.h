@@ -0,0 +1,89 @@
+/*
+
+	loopback.h
+	Round-trip latency measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _LOOPBACK_H_
+#define _LOOPBACK_H_
+
+#include <stdio.h>
+
+
+/* Maximum length sequence from a 10 bit shift register */
+#define LOOPBACK_MLS_BITS		10
+#define LOOPBACK_MLS_LEN		((1 << LOOPBACK_MLS_BITS) - 1)
+
+/* Level of the burst */
+#define LOOPBACK_LEVEL			-20.0f
+
+/* Longest round trip that can be measured */
+#define LOOPBACK_MAX_SECS		1.0
+
+/* Gap between bursts */
+#define LOOPBACK_INTERVAL_SECS	2.0
+
+/* Correlation is worked out around the onset, this many lags per cycle */
+#define LOOPBACK_SEARCH			256
+#define LOOPBACK_LAGS_PER_CYCLE	64
+
+
+enum { LOOPBACK_IDLE = 0, LOOPBACK_CAPTURE, LOOPBACK_SEARCH_ONSET, LOOPBACK_SEARCH_PEAK };
+
+
+/*
+	Plays an MLS burst on an output and records the input from the
+	same frame onwards. The onset of the burst in the recording gives
+	a rough position, and correlating with the MLS either side of it
+	gives the round trip to the sample. The burst is played and
+	recorded before JACK is signalled; the search runs after, in the
+	same thread, spread over several cycles so that no single one
+	takes long.
+*/
+typedef struct {
+	float mls[LOOPBACK_MLS_LEN];
+	float *capture;
+	unsigned long capture_len;
+	unsigned long interval;
+
+	int state;
+	unsigned long count;
+
+	unsigned long lag, lag_end;
+	float best;
+	unsigned long best_lag;
+
+	/* Latest result, published by the process thread */
+	unsigned long latency;
+	float confidence;
+	volatile unsigned int seq;
+
+	/* Only used by the main thread */
+	unsigned int seen;
+} loopback_t;
+
+
+loopback_t *loopback_new( double samplerate );
+void loopback_process( loopback_t *lb, const float *in, float *out, unsigned int nframes );
+void loopback_analyse( loopback_t *lb );
+int loopback_result( loopback_t *lb, unsigned long *latency, float *confidence );
+void loopback_free( loopback_t *lb );
+
+
+#endif
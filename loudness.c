@@ -0,0 +1,281 @@
+/*
+
+	loudness.c
+	BS.1770 channel group loudness for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "loudness.h"
+
+
+/* Weighting of channels between 60 and 120 degrees from the front, +1.5dB */
+#define SURROUND	1.41
+
+
+static const struct {
+	const char *layout;
+	unsigned int channels;
+	const char *name[LOUDNESS_CHANNELS_MAX];
+	double weight[LOUDNESS_CHANNELS_MAX];
+} layouts[] = {
+	{ "2.0", 2, { "L", "R" }, { 1, 1 } },
+	{ "5.1", 6, { "L", "R", "C", "LFE", "Ls", "Rs" }, { 1, 1, 1, 0, SURROUND, SURROUND } },
+	{ "7.1", 8, { "L", "R", "C", "LFE", "Lss", "Rss", "Lrs", "Rrs" }, { 1, 1, 1, 0, SURROUND, SURROUND, 1, 1 } },
+	{ "7.1.4", 12, { "L", "R", "C", "LFE", "Lss", "Rss", "Lrs", "Rrs", "Ltf", "Rtf", "Ltr", "Rtr" },
+		{ 1, 1, 1, 0, SURROUND, SURROUND, 1, 1, 1, 1, 1, 1 } },
+};
+
+
+/*
+	The K-weighting filter: a high shelf for the head, then the RLB
+	high-pass. Worked out for the sample rate from the analogue
+	parameters that give the 48kHz coefficients in BS.1770.
+*/
+static void k_weighting( double samplerate, biquad_coeffs_t *shelf, biquad_coeffs_t *highpass )
+{
+	const double vh = pow( 10.0, 3.999843853973347 / 20.0 );
+	const double vb = pow( vh, 0.4996667741545416 );
+	double k, q, a0;
+
+	k = tan( M_PI * 1681.974450955533 / samplerate );
+	q = 0.7071752369554196;
+	a0 = 1.0 + k / q + k * k;
+	shelf->b0 = (vh + vb * k / q + k * k) / a0;
+	shelf->b1 = 2.0 * (k * k - vh) / a0;
+	shelf->b2 = (vh - vb * k / q + k * k) / a0;
+	shelf->a1 = 2.0 * (k * k - 1.0) / a0;
+	shelf->a2 = (1.0 - k / q + k * k) / a0;
+
+	k = tan( M_PI * 38.13547087602444 / samplerate );
+	q = 0.5003270373238773;
+	a0 = 1.0 + k / q + k * k;
+	highpass->b0 = 1.0;
+	highpass->b1 = -2.0;
+	highpass->b2 = 1.0;
+	highpass->a1 = 2.0 * (k * k - 1.0) / a0;
+	highpass->a2 = (1.0 - k / q + k * k) / a0;
+}
+
+
+loudness_t *loudness_new( const char *layout, double samplerate )
+{
+	const unsigned int taps = LOUDNESS_TP_PHASES * LOUDNESS_TP_TAPS;
+	biquad_coeffs_t shelf, highpass;
+	loudness_t *loudness;
+	unsigned int i, c, p;
+	int found = -1;
+
+	for (i=0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+		if (strcmp( layout, layouts[i].layout ) == 0) found = i;
+	}
+	if (found < 0) return NULL;
+
+	loudness = calloc( 1, sizeof(loudness_t) );
+	if (loudness == NULL) return NULL;
+
+	loudness->layout = layouts[found].layout;
+	loudness->channels = layouts[found].channels;
+	for (c=0; c < loudness->channels; c++) {
+		loudness->name[c] = layouts[found].name[c];
+		loudness->weight[c] = layouts[found].weight[c];
+	}
+
+	loudness->bank = biquad_bank_new( loudness->channels, 2 );
+	if (loudness->bank == NULL) {
+		loudness_free( loudness );
+		return NULL;
+	}
+	k_weighting( samplerate, &shelf, &highpass );
+	for (c=0; c < loudness->channels; c++) {
+		biquad_bank_set( loudness->bank, c, 0, &shelf );
+		biquad_bank_set( loudness->bank, c, 1, &highpass );
+	}
+
+	// Hann windowed sinc, split into phases
+	for (i=0; i < taps; i++) {
+		const double x = (i - (taps - 1) / 2.0) / LOUDNESS_TP_PHASES;
+		const double sinc = (x == 0.0) ? 1.0 : sin( M_PI * x ) / (M_PI * x);
+		const double window = 0.5 - 0.5 * cos( 2.0 * M_PI * (i + 0.5) / taps );
+
+		loudness->tp_coeff[i % LOUDNESS_TP_PHASES][i / LOUDNESS_TP_PHASES] = sinc * window;
+	}
+	for (p=0; p < LOUDNESS_TP_PHASES; p++) {
+		float sum = 0.0f;
+		for (i=0; i < LOUDNESS_TP_TAPS; i++) sum += loudness->tp_coeff[p][i];
+		for (i=0; i < LOUDNESS_TP_TAPS; i++) loudness->tp_coeff[p][i] /= sum;
+	}
+
+	loudness->len = (unsigned long)(samplerate * LOUDNESS_STEP_SECS);
+	loudness->momentary = loudness->integrated = -INFINITY;
+
+	return loudness;
+}
+
+
+/* Loudness of a block from its weighted mean square */
+static double block_loudness( double ms )
+{
+	return -0.691 + 10.0 * log10( ms );
+}
+
+
+/* Gate the blocks in the histogram, as BS.1770 */
+static float integrate( loudness_t *loudness )
+{
+	double energy = 0.0, gate;
+	unsigned long count = 0;
+	unsigned int b, first;
+
+	for (b=0; b < LOUDNESS_BINS; b++) {
+		energy += loudness->bin_energy[b];
+		count += loudness->bin_count[b];
+	}
+	if (count == 0) return -INFINITY;
+
+	gate = block_loudness( energy / count ) + LOUDNESS_RELATIVE_GATE;
+	first = (gate > LOUDNESS_ABSOLUTE_GATE) ? (unsigned int)((gate - LOUDNESS_ABSOLUTE_GATE) / LOUDNESS_BIN_LU) : 0;
+
+	energy = 0.0;
+	count = 0;
+	for (b=first; b < LOUDNESS_BINS; b++) {
+		energy += loudness->bin_energy[b];
+		count += loudness->bin_count[b];
+	}
+
+	return count ? block_loudness( energy / count ) : -INFINITY;
+}
+
+
+/* Called once a step, with the weighted sum of squares over it */
+static void loudness_step( loudness_t *loudness )
+{
+	double ms = 0.0, l;
+	unsigned int s;
+
+	loudness->step_sum[loudness->step] = loudness->sum;
+	loudness->step = (loudness->step + 1) % LOUDNESS_STEPS;
+	loudness->sum = 0.0;
+	if (++loudness->steps_seen < LOUDNESS_STEPS) return;
+
+	for (s=0; s < LOUDNESS_STEPS; s++) ms += loudness->step_sum[s];
+	ms /= loudness->len * LOUDNESS_STEPS;
+	l = block_loudness( ms );
+
+	// Blocks under the absolute gate never count
+	if (l > LOUDNESS_ABSOLUTE_GATE) {
+		int b = (int)((l - LOUDNESS_ABSOLUTE_GATE) / LOUDNESS_BIN_LU);
+		if (b >= LOUDNESS_BINS) b = LOUDNESS_BINS - 1;
+		loudness->bin_count[b]++;
+		loudness->bin_energy[b] += ms;
+	}
+
+	loudness->momentary = l;
+	loudness->integrated = integrate( loudness );
+	loudness->true_peak = loudness->tp_max;
+	loudness->seq++;
+}
+
+
+/* Called from the JACK process callback */
+void loudness_process( loudness_t *loudness, const float * const *in, unsigned int nframes )
+{
+	biquad_bank_t *bank = loudness->bank;
+	const unsigned int channels = loudness->channels;
+	double *x = bank->x;
+	float tp_max = loudness->tp_max;
+	unsigned int i, c, p, t;
+
+	for (i=0; i < nframes; i++) {
+		const unsigned int pos = loudness->tp_pos;
+		double sum = 0.0;
+
+		for (c=0; c < channels; c++) x[c] = in[c][i];
+		biquad_bank_tick( bank );
+		for (c=0; c < channels; c++) sum += loudness->weight[c] * x[c] * x[c];
+		loudness->sum += sum;
+
+		// History is kept twice over, so that the taps are contiguous
+		for (c=0; c < channels; c++) {
+			float *h = loudness->tp_history[c];
+			h[pos] = h[pos + LOUDNESS_TP_TAPS] = in[c][i];
+
+			for (p=0; p < LOUDNESS_TP_PHASES; p++) {
+				const float *coeff = loudness->tp_coeff[p];
+				float y = 0.0f;
+
+				for (t=0; t < LOUDNESS_TP_TAPS; t++) {
+					y += coeff[t] * h[pos + LOUDNESS_TP_TAPS - t];
+				}
+				y = fabsf( y );
+				if (y > tp_max) tp_max = y;
+			}
+		}
+		loudness->tp_pos = (pos + 1) % LOUDNESS_TP_TAPS;
+
+		loudness->tp_max = tp_max;
+		if (++loudness->pos >= loudness->len) {
+			loudness->pos = 0;
+			loudness_step( loudness );
+		}
+	}
+}
+
+
+/* Called from the JACK process callback, to start integrating again */
+void loudness_reset( loudness_t *loudness )
+{
+	biquad_bank_reset( loudness->bank );
+	memset( loudness->tp_history, 0, sizeof(loudness->tp_history) );
+	memset( loudness->step_sum, 0, sizeof(loudness->step_sum) );
+	memset( loudness->bin_count, 0, sizeof(loudness->bin_count) );
+	memset( loudness->bin_energy, 0, sizeof(loudness->bin_energy) );
+	loudness->tp_pos = 0;
+	loudness->tp_max = 0.0f;
+	loudness->step = loudness->steps_seen = 0;
+	loudness->sum = 0.0;
+	loudness->pos = 0;
+	loudness->momentary = loudness->integrated = -INFINITY;
+	loudness->true_peak = 0.0f;
+}
+
+
+/* Print the levels once a second */
+void loudness_report( loudness_t *loudness, FILE *out )
+{
+	const unsigned int per_report = (unsigned int)(1.0 / LOUDNESS_STEP_SECS);
+
+	if (loudness->seq / per_report == loudness->seen) return;
+	loudness->seen = loudness->seq / per_report;
+
+	fprintf(out, "%s loudness: momentary %1.1f LUFS, integrated %1.1f LUFS, true peak %1.1f dBTP\n",
+		loudness->layout, loudness->momentary, loudness->integrated, 20.0f * log10f( loudness->true_peak ));
+}
+
+
+void loudness_free( loudness_t *loudness )
+{
+	if (loudness == NULL) return;
+
+	biquad_bank_free( loudness->bank );
+	free( loudness );
+}
@@ -0,0 +1,101 @@
+/*
+
+	loudness.h
+	BS.1770 channel group loudness for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _LOUDNESS_H_
+#define _LOUDNESS_H_
+
+#include <stdio.h>
+#include "biquad.h"
+
+
+/* Most channels in a group (7.1.4) */
+#define LOUDNESS_CHANNELS_MAX	12
+
+/* Gating blocks are 400ms, every 100ms */
+#define LOUDNESS_STEP_SECS		0.1
+#define LOUDNESS_STEPS			4
+
+/* Gates for integrated loudness, and the histogram the blocks are kept in */
+#define LOUDNESS_ABSOLUTE_GATE	-70.0
+#define LOUDNESS_RELATIVE_GATE	-10.0
+#define LOUDNESS_BIN_LU			0.1
+#define LOUDNESS_BINS			1000
+
+/* True peak from 4x oversampling, 12 taps per phase */
+#define LOUDNESS_TP_PHASES		4
+#define LOUDNESS_TP_TAPS		12
+
+
+/*
+	Loudness of a group of channels, as ITU-R BS.1770: each channel
+	is K-weighted, and the mean squares summed with the channel
+	weights (side surrounds +1.5dB, LFE left out). The channels are the
+	lanes of one filter bank, so the whole group is filtered in one
+	pass. Gating blocks go into a histogram, so that the integrated
+	loudness can be worked out again after every block without
+	keeping them all.
+*/
+typedef struct {
+	const char *layout;
+	unsigned int channels;
+	const char *name[LOUDNESS_CHANNELS_MAX];
+	double weight[LOUDNESS_CHANNELS_MAX];
+
+	biquad_bank_t *bank;
+
+	/* True peak interpolator, and recent samples of each channel */
+	float tp_coeff[LOUDNESS_TP_PHASES][LOUDNESS_TP_TAPS];
+	float tp_history[LOUDNESS_CHANNELS_MAX][LOUDNESS_TP_TAPS * 2];
+	unsigned int tp_pos;
+	float tp_max;
+
+	double step_sum[LOUDNESS_STEPS];
+	unsigned int step;
+	unsigned int steps_seen;
+	double sum;
+	unsigned long pos, len;
+
+	unsigned long bin_count[LOUDNESS_BINS];
+	double bin_energy[LOUDNESS_BINS];
+
+	/* Published by the process callback, after each block */
+	float momentary;
+	float integrated;
+	float true_peak;
+	volatile unsigned int seq;
+
+	/* Only used by the main thread */
+	unsigned int seen;
+} loudness_t;
+
+
+/* layout is 2.0, 5.1, 7.1 or 7.1.4 */
+loudness_t *loudness_new( const char *layout, double samplerate );
+
+/* in has one buffer per channel of the group */
+void loudness_process( loudness_t *loudness, const float * const *in, unsigned int nframes );
+void loudness_reset( loudness_t *loudness );
+void loudness_report( loudness_t *loudness, FILE *out );
+void loudness_free( loudness_t *loudness );
+
+
+#endif
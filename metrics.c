@@ -0,0 +1,348 @@
+/*
+
+	metrics.c
+	OpenMetrics scrape endpoint for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "metrics.h"
+
+
+/* Upper bounds of the timing buckets, the last one being +Inf */
+static const unsigned long bucket_usecs[METRICS_BUCKETS-1] = {
+	10, 25, 50, 100, 250, 500, 1000, 2500, 5000
+};
+
+
+/* Called from the JACK process callback */
+void metrics_process( metrics_t *metrics, const float *in, const float *weighted, unsigned int nframes,
+                      unsigned long usecs, unsigned long cycle_usecs )
+{
+	metrics_snapshot_t *work = &metrics->work;
+	float peak = 0.0f;
+	double sum = 0.0, wsum = 0.0;
+	unsigned long clips = 0;
+	unsigned int i, b;
+
+	for (i=0; i < nframes; i++) {
+		const float s = fabsf( in[i] );
+		if (s > peak) peak = s;
+		if (s >= 1.0f) clips++;
+		sum += in[i] * in[i];
+	}
+	if (weighted) {
+		for (i=0; i < nframes; i++) {
+			wsum += weighted[i] * weighted[i];
+		}
+	}
+
+	// Silence is judged period by period, on the peak of this period alone
+	if (20.0f * log10f( peak * metrics->bias ) < METRICS_SILENCE_DB) {
+		metrics->quiet_frames += nframes;
+	} else {
+		metrics->quiet_frames = 0;
+	}
+	work->silent = (metrics->quiet_frames >= metrics->silence_len);
+
+	work->frames += nframes;
+	work->clips += clips;
+	work->callbacks++;
+	work->callback_secs += usecs * 1e-6;
+	work->cycle_secs += cycle_usecs * 1e-6;
+	for (b=0; b < METRICS_BUCKETS-1 && usecs > bucket_usecs[b]; b++);
+	work->buckets[b]++;
+
+	if (peak > metrics->window_peak) metrics->window_peak = peak;
+	metrics->window_sum += sum;
+	metrics->window_weighted_sum += wsum;
+	metrics->window_frames += nframes;
+	if (metrics->window_frames >= metrics->window_len) {
+		work->peak = metrics->window_peak;
+		work->ms = metrics->window_sum / metrics->window_frames;
+		work->weighted_ms = metrics->window_weighted_sum / metrics->window_frames;
+		work->weighted = (weighted != NULL);
+		metrics->window_peak = 0.0f;
+		metrics->window_sum = metrics->window_weighted_sum = 0.0;
+		metrics->window_frames = 0;
+	}
+
+	// Odd count while the snapshot is being written
+	metrics->seq++;
+	__sync_synchronize();
+	metrics->snapshot = *work;
+	__sync_synchronize();
+	metrics->seq++;
+}
+
+
+void metrics_group( metrics_t *metrics, unsigned int g, const char *layout,
+                    float momentary, float integrated, float true_peak )
+{
+	metrics_snapshot_t *work = &metrics->work;
+
+	if (g >= METRICS_GROUPS) return;
+	if (g >= work->groups) work->groups = g + 1;
+	work->layout[g] = layout;
+	work->momentary[g] = momentary;
+	work->integrated[g] = integrated;
+	work->true_peak[g] = true_peak;
+}
+
+
+void metrics_xrun( metrics_t *metrics )
+{
+	metrics->xruns++;
+}
+
+
+/* A consistent copy of the latest snapshot */
+static void metrics_read( metrics_t *metrics, metrics_snapshot_t *snap )
+{
+	unsigned int seq;
+
+	do {
+		while ((seq = metrics->seq) & 1) usleep( 10 );
+		__sync_synchronize();
+		*snap = metrics->snapshot;
+		__sync_synchronize();
+	} while (seq != metrics->seq);
+}
+
+
+static float metrics_db( float ms, float bias )
+{
+	return 10.0f * log10f( ms * bias * bias );
+}
+
+
+/* A value as OpenMetrics writes it, which spells infinity +Inf and -Inf */
+static const char *metrics_value( float value, char *buf, size_t size )
+{
+	if (isnan( value )) return "NaN";
+	if (isinf( value )) return (value > 0.0f) ? "+Inf" : "-Inf";
+	snprintf( buf, size, "%1.2f", value );
+	return buf;
+}
+
+
+/* Write the exposition for one scrape */
+static int metrics_format( metrics_t *metrics, char *buf, size_t size )
+{
+	metrics_snapshot_t snap;
+	unsigned long long cumulative = 0;
+	char v1[32], v2[32];
+	int len = 0;
+	unsigned int b, g;
+
+	metrics_read( metrics, &snap );
+
+	len += snprintf( buf + len, size - len,
+		"# TYPE jack_meter_peak_db gauge\n"
+		"# HELP jack_meter_peak_db Peak level over the last second, relative to the reference level.\n"
+		"jack_meter_peak_db %s\n"
+		"# TYPE jack_meter_rms_db gauge\n"
+		"# HELP jack_meter_rms_db RMS level over the last second, relative to the reference level.\n"
+		"jack_meter_rms_db %s\n",
+		metrics_value( 20.0f * log10f( snap.peak * metrics->bias ), v1, sizeof(v1) ),
+		metrics_value( metrics_db( snap.ms, metrics->bias ), v2, sizeof(v2) ) );
+	if (snap.weighted) {
+		len += snprintf( buf + len, size - len,
+			"# TYPE jack_meter_weighted_rms_db gauge\n"
+			"# HELP jack_meter_weighted_rms_db Frequency weighted RMS level over the last second.\n"
+			"jack_meter_weighted_rms_db %s\n",
+			metrics_value( metrics_db( snap.weighted_ms, metrics->bias ), v1, sizeof(v1) ) );
+	}
+	if (snap.groups) {
+		len += snprintf( buf + len, size - len,
+			"# TYPE jack_meter_momentary_lufs gauge\n"
+			"# HELP jack_meter_momentary_lufs Momentary loudness of each channel group.\n" );
+		for (g=0; g < snap.groups; g++) {
+			len += snprintf( buf + len, size - len, "jack_meter_momentary_lufs{group=\"%u\",layout=\"%s\"} %s\n",
+				g+1, snap.layout[g], metrics_value( snap.momentary[g], v1, sizeof(v1) ) );
+		}
+		len += snprintf( buf + len, size - len,
+			"# TYPE jack_meter_integrated_lufs gauge\n"
+			"# HELP jack_meter_integrated_lufs Integrated loudness of each channel group.\n" );
+		for (g=0; g < snap.groups; g++) {
+			len += snprintf( buf + len, size - len, "jack_meter_integrated_lufs{group=\"%u\",layout=\"%s\"} %s\n",
+				g+1, snap.layout[g], metrics_value( snap.integrated[g], v1, sizeof(v1) ) );
+		}
+		len += snprintf( buf + len, size - len,
+			"# TYPE jack_meter_true_peak_dbtp gauge\n"
+			"# HELP jack_meter_true_peak_dbtp Highest true peak of each channel group.\n" );
+		for (g=0; g < snap.groups; g++) {
+			len += snprintf( buf + len, size - len, "jack_meter_true_peak_dbtp{group=\"%u\",layout=\"%s\"} %s\n",
+				g+1, snap.layout[g], metrics_value( 20.0f * log10f( snap.true_peak[g] ), v1, sizeof(v1) ) );
+		}
+	}
+	len += snprintf( buf + len, size - len,
+		"# TYPE jack_meter_silent gauge\n"
+		"# HELP jack_meter_silent Whether the input has been silent for %g seconds.\n"
+		"jack_meter_silent %d\n"
+		"# TYPE jack_meter_frames counter\n"
+		"# HELP jack_meter_frames Frames metered.\n"
+		"jack_meter_frames_total %llu\n"
+		"# TYPE jack_meter_clipped_samples counter\n"
+		"# HELP jack_meter_clipped_samples Samples at or above full scale.\n"
+		"jack_meter_clipped_samples_total %llu\n"
+		"# TYPE jack_meter_xruns counter\n"
+		"# HELP jack_meter_xruns Xruns reported by the JACK server.\n"
+		"jack_meter_xruns_total %lu\n"
+		"# TYPE jack_meter_callback_seconds histogram\n"
+		"# HELP jack_meter_callback_seconds Time the JACK graph waited for us each cycle.\n",
+		METRICS_SILENCE_SECS, snap.silent, snap.frames, snap.clips, metrics->xruns );
+	for (b=0; b < METRICS_BUCKETS; b++) {
+		cumulative += snap.buckets[b];
+		if (b < METRICS_BUCKETS-1) {
+			len += snprintf( buf + len, size - len, "jack_meter_callback_seconds_bucket{le=\"%g\"} %llu\n",
+				bucket_usecs[b] * 1e-6, cumulative );
+		} else {
+			len += snprintf( buf + len, size - len, "jack_meter_callback_seconds_bucket{le=\"+Inf\"} %llu\n",
+				cumulative );
+		}
+	}
+	len += snprintf( buf + len, size - len,
+		"jack_meter_callback_seconds_count %llu\n"
+		"jack_meter_callback_seconds_sum %1.6f\n"
+		"# TYPE jack_meter_cycle_seconds counter\n"
+		"# HELP jack_meter_cycle_seconds Time taken by each cycle, including after JACK was signalled.\n"
+		"jack_meter_cycle_seconds_total %1.6f\n"
+		"# EOF\n",
+		snap.callbacks, snap.callback_secs, snap.cycle_secs );
+
+	return len;
+}
+
+
+static void *metrics_thread( void *arg )
+{
+	metrics_t *metrics = arg;
+	const struct timeval timeout = { METRICS_TIMEOUT_SECS, 0 };
+	char request[1024], body[8192], header[256];
+	int fd;
+
+	while ((fd = accept( metrics->sock, NULL, NULL )) >= 0) {
+		ssize_t got;
+		int len, hlen;
+
+		// A client that never sends its request mustn't hold up the next scrape
+		setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) );
+		setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout) );
+		got = recv( fd, request, sizeof(request) - 1, 0 );
+
+		if (got > 0) {
+			request[got] = 0;
+			if (strncmp( request, "GET /metrics ", 13 ) == 0 || strncmp( request, "GET / ", 6 ) == 0) {
+				len = metrics_format( metrics, body, sizeof(body) );
+				hlen = snprintf( header, sizeof(header),
+					"HTTP/1.0 200 OK\r\n"
+					"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+					"Content-Length: %d\r\n\r\n", len );
+				send( fd, header, hlen, MSG_NOSIGNAL );
+				send( fd, body, len, MSG_NOSIGNAL );
+			} else {
+				const char *missing = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+				send( fd, missing, strlen( missing ), MSG_NOSIGNAL );
+			}
+		}
+		close( fd );
+	}
+
+	return NULL;
+}
+
+
+/* The window and silence lengths are read by the process callback */
+void metrics_set_samplerate( metrics_t *metrics, double samplerate )
+{
+	metrics->window_len = (unsigned long)(samplerate * METRICS_SECS);
+	metrics->silence_len = (unsigned long)(samplerate * METRICS_SILENCE_SECS);
+}
+
+
+metrics_t *metrics_new( const char *spec, double samplerate, float bias )
+{
+	metrics_t *metrics;
+	struct sockaddr_in addr;
+	const char *colon = strrchr( spec, ':' );
+	char host[64] = "127.0.0.1";
+	char *end;
+	long port;
+	int on = 1;
+
+	port = strtol( colon ? colon + 1 : spec, &end, 10 );
+	if (*end || port < 1 || port > 65535) return NULL;
+	if (colon) {
+		if ((size_t)(colon - spec) >= sizeof(host)) return NULL;
+		memcpy( host, spec, colon - spec );
+		host[colon - spec] = 0;
+	}
+
+	memset( &addr, 0, sizeof(addr) );
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( port );
+	if (inet_pton( AF_INET, host, &addr.sin_addr ) != 1) return NULL;
+
+	metrics = calloc( 1, sizeof(metrics_t) );
+	if (metrics == NULL) return NULL;
+
+	metrics->bias = bias;
+	metrics_set_samplerate( metrics, samplerate );
+
+	metrics->sock = socket( AF_INET, SOCK_STREAM, 0 );
+	if (metrics->sock < 0) {
+		metrics_free( metrics );
+		return NULL;
+	}
+	setsockopt( metrics->sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) );
+	if (bind( metrics->sock, (struct sockaddr *) &addr, sizeof(addr) ) ||
+	    listen( metrics->sock, 8 ) ||
+	    pthread_create( &metrics->thread, NULL, metrics_thread, metrics )) {
+		metrics_free( metrics );
+		return NULL;
+	}
+	metrics->started = 1;
+
+	return metrics;
+}
+
+
+void metrics_free( metrics_t *metrics )
+{
+	if (metrics == NULL) return;
+
+	// Closing the socket stops the thread
+	if (metrics->sock >= 0) {
+		shutdown( metrics->sock, SHUT_RDWR );
+		close( metrics->sock );
+	}
+	if (metrics->started) {
+		pthread_join( metrics->thread, NULL );
+	}
+	free( metrics );
+}
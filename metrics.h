@@ -0,0 +1,118 @@
+/*
+
+	metrics.h
+	OpenMetrics scrape endpoint for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <pthread.h>
+
+
+/* Levels are published over this length */
+#define METRICS_SECS			1.0
+
+/* Silent when the peak has been below this level for this long */
+#define METRICS_SILENCE_DB		-60.0f
+#define METRICS_SILENCE_SECS	10.0
+
+/* Buckets of the process callback timing histogram, in microseconds */
+#define METRICS_BUCKETS			10
+
+/* Most channel groups whose loudness is published */
+#define METRICS_GROUPS			4
+
+/* A scrape that takes longer than this to send or receive is dropped */
+#define METRICS_TIMEOUT_SECS	2
+
+
+/* Everything a scrape reports */
+typedef struct {
+	float peak;
+	float ms;
+	float weighted_ms;
+	int weighted;
+	int silent;
+
+	unsigned long long frames;
+	unsigned long long clips;
+	unsigned long long callbacks;
+	unsigned long long buckets[METRICS_BUCKETS];
+	double callback_secs;
+	double cycle_secs;
+
+	unsigned int groups;
+	const char *layout[METRICS_GROUPS];
+	float momentary[METRICS_GROUPS];
+	float integrated[METRICS_GROUPS];
+	float true_peak[METRICS_GROUPS];
+} metrics_snapshot_t;
+
+
+/*
+	The process callback keeps its own copy of the statistics, and
+	publishes it to the snapshot under a sequence count every period.
+	The HTTP thread copies the snapshot out, trying again if the count
+	changed while it was copying, so a scrape never holds up the
+	process callback and never sees half an update.
+*/
+typedef struct {
+	float bias;
+
+	/* Only touched by the process callback */
+	metrics_snapshot_t work;
+	float window_peak;
+	double window_sum, window_weighted_sum;
+	unsigned long window_frames, window_len;
+	unsigned long quiet_frames, silence_len;
+
+	/* Published by the process callback */
+	metrics_snapshot_t snapshot;
+	volatile unsigned int seq;
+
+	/* Counted by the xrun callback */
+	volatile unsigned long xruns;
+
+	int sock;
+	pthread_t thread;
+	int started;
+} metrics_t;
+
+
+/* spec is [host:]port, host defaulting to 127.0.0.1 */
+metrics_t *metrics_new( const char *spec, double samplerate, float bias );
+void metrics_set_samplerate( metrics_t *metrics, double samplerate );
+
+/*
+	weighted is NULL without a weighting filter, usecs is how long the
+	JACK graph waited for us and cycle_usecs how long the cycle has
+	taken so far, including the work after JACK was signalled.
+*/
+void metrics_process( metrics_t *metrics, const float *in, const float *weighted, unsigned int nframes,
+                      unsigned long usecs, unsigned long cycle_usecs );
+
+/* Loudness of channel group g, from the process callback ahead of metrics_process */
+void metrics_group( metrics_t *metrics, unsigned int g, const char *layout,
+                    float momentary, float integrated, float true_peak );
+void metrics_xrun( metrics_t *metrics );
+void metrics_free( metrics_t *metrics );
+
+
+#endif
@@ -0,0 +1,143 @@
+/*
+
+	midi.c
+	MIDI level output for control surfaces for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "midi.h"
+
+
+/* Lowest level for each Mackie Control meter segment, 1 to 12 */
+static const float mackie_segments[12] = {
+	-60.0f, -50.0f, -40.0f, -30.0f, -20.0f, -14.0f,
+	-10.0f, -8.0f, -6.0f, -4.0f, -2.0f, 0.0f
+};
+
+
+midi_t *midi_new( const char *spec, double samplerate, float rate, float bias )
+{
+	midi_t *midi;
+	const char *arg = strchr( spec, ':' );
+	size_t len = arg ? (size_t)(arg - spec) : strlen( spec );
+
+	if (rate <= 0.0f) return NULL;
+
+	midi = calloc( 1, sizeof(midi_t) );
+	if (midi == NULL) return NULL;
+
+	if (len == 2 && strncmp( spec, "cc", 2 ) == 0) {
+		midi->type = MIDI_CC;
+		midi->channel = MIDI_CC_CHANNEL;
+		midi->number = MIDI_CC_CONTROLLER;
+		if (arg) {
+			midi->channel = atoi( arg + 1 );
+			arg = strchr( arg + 1, ':' );
+			if (arg) midi->number = atoi( arg + 1 );
+		}
+	} else if (len == 6 && strncmp( spec, "mackie", 6 ) == 0) {
+		midi->type = MIDI_MACKIE;
+		if (arg) midi->number = atoi( arg + 1 );
+	} else {
+		midi_free( midi );
+		return NULL;
+	}
+
+	if ((midi->type == MIDI_CC && (midi->channel < 1 || midi->channel > 16 || midi->number > 127)) ||
+	    (midi->type == MIDI_MACKIE && midi->number > 7)) {
+		midi_free( midi );
+		return NULL;
+	}
+
+	midi->bias = bias;
+	midi->interval = (unsigned long)(samplerate / rate);
+	if (midi->interval == 0) midi->interval = 1;
+	midi->left = midi->interval;
+	midi->last = -1;
+
+	return midi;
+}
+
+
+/* Write a message for the peak so far, at frame time */
+static void midi_send( midi_t *midi, void *buf, unsigned int time )
+{
+	const float db = 20.0f * log10f( midi->peak * midi->bias );
+	jack_midi_data_t msg[3];
+
+	if (midi->type == MIDI_CC) {
+		int value = (int) lrintf( (db + MIDI_CC_RANGE) * 127.0f / MIDI_CC_RANGE );
+
+		if (value < 0) value = 0;
+		if (value > 127) value = 127;
+		if (value == midi->last) return;
+		midi->last = value;
+
+		msg[0] = 0xB0 | (midi->channel - 1);
+		msg[1] = midi->number;
+		msg[2] = value;
+		jack_midi_event_write( buf, time, msg, 3 );
+	} else {
+		int level = 0;
+
+		while (level < 12 && db >= mackie_segments[level]) level++;
+
+		// Channel pressure: strip in the top nibble, 0xE lights the overload
+		msg[0] = 0xD0;
+		msg[1] = (midi->number << 4) | (midi->peak >= 1.0f ? 0xE : level);
+		jack_midi_event_write( buf, time, msg, 2 );
+	}
+}
+
+
+void midi_process( midi_t *midi, const float *in, void *buf, unsigned int nframes )
+{
+	unsigned int i = 0;
+
+	jack_midi_clear_buffer( buf );
+
+	while (i < nframes) {
+		const unsigned int n = (nframes - i < midi->left) ? nframes - i : midi->left;
+		const unsigned int end = i + n;
+		float peak = midi->peak;
+
+		for (; i < end; i++) {
+			const float s = fabsf( in[i] );
+			if (s > peak) peak = s;
+		}
+		midi->peak = peak;
+		midi->left -= n;
+
+		if (midi->left == 0) {
+			midi_send( midi, buf, i - 1 );
+			midi->peak = 0.0f;
+			midi->left = midi->interval;
+		}
+	}
+}
+
+
+void midi_free( midi_t *midi )
+{
+	free( midi );
+}
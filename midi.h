@@ -0,0 +1,71 @@
+/*
+
+	midi.h
+	MIDI level output for control surfaces for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _MIDI_H_
+#define _MIDI_H_
+
+#include <jack/midiport.h>
+
+
+/* Messages per second, unless given */
+#define MIDI_RATE			10.0f
+
+/* Defaults for control change messages */
+#define MIDI_CC_CHANNEL		1
+#define MIDI_CC_CONTROLLER	20
+
+/* Range of the control change value, in dB below the reference level */
+#define MIDI_CC_RANGE		60.0f
+
+
+enum { MIDI_CC = 0, MIDI_MACKIE };
+
+
+/*
+	Sends the peak level over each interval as a MIDI message, timed
+	at the frame the interval ends on. Control change values are
+	linear in dB and only sent when they change; Mackie Control meter
+	messages are sent every interval, since the surface lets its
+	meters fall on their own.
+*/
+typedef struct {
+	int type;
+	float bias;
+	unsigned int channel;
+	unsigned int number;
+
+	unsigned long interval;
+	unsigned long left;
+	float peak;
+	int last;
+} midi_t;
+
+
+/* spec is cc[:channel[:controller]] or mackie[:strip] */
+midi_t *midi_new( const char *spec, double samplerate, float rate, float bias );
+
+/* Called from the JACK process callback, with the MIDI port's buffer */
+void midi_process( midi_t *midi, const float *in, void *buf, unsigned int nframes );
+void midi_free( midi_t *midi );
+
+
+#endif
@@ -0,0 +1,115 @@
+/*
+
+	noise.c
+	Noise floor tracking for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "noise.h"
+
+
+noise_t *noise_new( double samplerate, float secs )
+{
+	const unsigned int count = (unsigned int)(secs / NOISE_SHORT_SECS + 0.5);
+	noise_t *noise;
+
+	if (count < 2) return NULL;
+
+	noise = calloc( 1, sizeof(noise_t) );
+	if (noise == NULL) return NULL;
+
+	noise->short_len = (unsigned long)(samplerate * NOISE_SHORT_SECS);
+	noise->min = mono_deque_new( count, 0 );
+	noise->max = mono_deque_new( count, 1 );
+	if (noise->min == NULL || noise->max == NULL) {
+		noise_free( noise );
+		return NULL;
+	}
+
+	return noise;
+}
+
+
+/* Called from the JACK process callback */
+void noise_process( noise_t *noise, const float *in, unsigned int nframes )
+{
+	double sum = 0.0;
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		sum += in[i] * in[i];
+	}
+	noise->energy += sum;
+	noise->frames += nframes;
+
+	// Short windows end on a period boundary
+	if (noise->frames >= noise->short_len) {
+		const double ms = noise->energy / noise->frames;
+
+		mono_deque_push( noise->min, ms );
+		mono_deque_push( noise->max, ms );
+		noise->floor_ms = mono_deque_front( noise->min );
+		noise->program_ms = mono_deque_front( noise->max );
+		noise->windows++;
+
+		noise->energy = 0.0;
+		noise->frames = 0;
+	}
+}
+
+
+/* Print the noise floor each time the long window has moved on by its own length */
+void noise_report( noise_t *noise, float bias, FILE *out )
+{
+	const unsigned long windows = noise->windows;
+	float floor_db, program_db;
+
+	if (windows - noise->reported < noise->min->size) return;
+	noise->reported = windows;
+
+	// Digital silence has no floor to measure against
+	if (noise->program_ms <= 0.0) {
+		fprintf(out, "Noise floor: no signal\n");
+		return;
+	}
+
+	program_db = 10.0f * log10f( noise->program_ms * bias * bias );
+	if (noise->floor_ms <= 0.0) {
+		fprintf(out, "Noise floor: -inf dB (digital silence), programme: %1.1fdB, SNR: n/a\n",
+			program_db);
+		return;
+	}
+
+	floor_db = 10.0f * log10f( noise->floor_ms * bias * bias );
+	fprintf(out, "Noise floor: %1.1fdB, programme: %1.1fdB, SNR: %1.1fdB\n",
+		floor_db, program_db, program_db - floor_db);
+}
+
+
+void noise_free( noise_t *noise )
+{
+	if (noise == NULL) return;
+
+	mono_deque_free( noise->min );
+	mono_deque_free( noise->max );
+	free( noise );
+}
@@ -0,0 +1,63 @@
+/*
+
+	noise.h
+	Noise floor tracking for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _NOISE_H_
+#define _NOISE_H_
+
+#include <stdio.h>
+#include "window.h"
+
+
+/* Length of the short RMS windows that the minimum is taken over */
+#define NOISE_SHORT_SECS	0.1
+
+
+/*
+	Minimum statistics: the noise floor is the quietest short-window
+	RMS level over the last few seconds, and the programme level is
+	the loudest one over the same time.
+*/
+typedef struct {
+	unsigned long short_len;
+	double energy;
+	unsigned long frames;
+
+	mono_deque_t *min;
+	mono_deque_t *max;
+
+	/* Mean squares published by the process callback */
+	double floor_ms;
+	double program_ms;
+	volatile unsigned long windows;
+
+	/* Only used by the main thread */
+	unsigned long reported;
+} noise_t;
+
+
+noise_t *noise_new( double samplerate, float secs );
+void noise_process( noise_t *noise, const float *in, unsigned int nframes );
+void noise_report( noise_t *noise, float bias, FILE *out );
+void noise_free( noise_t *noise );
+
+
+#endif
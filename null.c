@@ -0,0 +1,167 @@
+/*
+
+	null.c
+	Null test between two inputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "null.h"
+
+
+null_t *null_new( unsigned int size, unsigned int chunk, double samplerate, float threshold )
+{
+	null_t *n = calloc( 1, sizeof(null_t) );
+
+	if (n == NULL) return NULL;
+
+	// Room for the delay plus a chunk of new samples
+	n->size = size + chunk;
+	n->main = calloc( n->size, sizeof(float) );
+	n->compare = calloc( n->size, sizeof(float) );
+	n->lag = malloc( sizeof(float) * chunk );
+	n->lead = malloc( sizeof(float) * chunk );
+	if (!n->main || !n->compare || !n->lag || !n->lead) {
+		null_free( n );
+		return NULL;
+	}
+
+	n->threshold = threshold;
+	n->len = (unsigned long)(samplerate * NULL_SECS);
+
+	return n;
+}
+
+
+/*
+	Sum of squares of (lag - sign * lead) and of lag.
+	Kept in separate lanes so that the compiler can vectorise
+	the loop without reordering a single sum.
+*/
+static void null_kernel( const float * restrict lag, const float * restrict lead, float sign,
+                         unsigned int len, double *residual, double *programme )
+{
+	float r[NULL_LANES] = { 0 }, p[NULL_LANES] = { 0 };
+	unsigned int i, l;
+
+	for (i=0; i + NULL_LANES <= len; i += NULL_LANES) {
+		for (l=0; l < NULL_LANES; l++) {
+			const float d = lag[i+l] - sign * lead[i+l];
+			r[l] += d * d;
+			p[l] += lag[i+l] * lag[i+l];
+		}
+	}
+	for (; i < len; i++) {
+		const float d = lag[i] - sign * lead[i];
+		r[0] += d * d;
+		p[0] += lag[i] * lag[i];
+	}
+
+	for (l=0; l < NULL_LANES; l++) {
+		*residual += r[l];
+		*programme += p[l];
+	}
+}
+
+
+/* Copy len samples from a ring, starting 'back' samples before the write position */
+static void ring_copy( const null_t *n, const float *ring, unsigned int back, float *dest, unsigned int len )
+{
+	const unsigned int start = (n->pos + n->size - back) % n->size;
+	const unsigned int first = (start + len <= n->size) ? len : n->size - start;
+
+	memcpy( dest, ring + start, sizeof(float) * first );
+	memcpy( dest + first, ring, sizeof(float) * (len - first) );
+}
+
+
+static void null_check( null_t *n, FILE *out )
+{
+	const float programme = 10.0f * log10f( n->programme / n->frames );
+	const float level = 10.0f * log10f( n->residual / n->programme );
+	int alarm;
+
+	n->residual = n->programme = 0.0;
+	n->frames = 0;
+
+	if (programme < NULL_MIN_PROGRAMME) return;
+
+	alarm = (level > n->threshold);
+	if (!n->reported || alarm != n->alarm) {
+		if (alarm) {
+			fprintf(out, "Null test ALARM: residual %1.1fdB relative to programme (threshold %1.1fdB)\n", level, n->threshold);
+		} else {
+			fprintf(out, "Null test OK: residual %1.1fdB relative to programme\n", level);
+		}
+		n->alarm = alarm;
+		n->reported = 1;
+	}
+}
+
+
+/*
+	Add interleaved pairs of samples (main, compare), no more than chunk.
+	delay is how many samples compare lags main by.
+*/
+void null_add( null_t *n, const float *frames, unsigned int nframes, int delay, int inverted, FILE *out )
+{
+	const unsigned int shift = abs( delay );
+	unsigned int i;
+
+	// Start measuring again if the alignment has moved
+	if (delay != n->delay) {
+		n->residual = n->programme = 0.0;
+		n->frames = 0;
+		n->delay = delay;
+	}
+
+	for (i=0; i < nframes; i++) {
+		n->main[ (n->pos + i) % n->size ] = frames[i*2];
+		n->compare[ (n->pos + i) % n->size ] = frames[i*2+1];
+	}
+	n->pos = (n->pos + nframes) % n->size;
+	n->total += nframes;
+
+	if (shift + nframes > n->size || n->total < shift + nframes) return;
+
+	// Whichever input is behind, against the other one 'shift' samples ago
+	ring_copy( n, delay >= 0 ? n->compare : n->main, nframes, n->lag, nframes );
+	ring_copy( n, delay >= 0 ? n->main : n->compare, shift + nframes, n->lead, nframes );
+	null_kernel( n->lag, n->lead, inverted ? -1.0f : 1.0f, nframes, &n->residual, &n->programme );
+
+	n->frames += nframes;
+	if (n->frames >= n->len) {
+		null_check( n, out );
+	}
+}
+
+
+void null_free( null_t *n )
+{
+	if (n == NULL) return;
+
+	free( n->main );
+	free( n->compare );
+	free( n->lag );
+	free( n->lead );
+	free( n );
+}
@@ -0,0 +1,70 @@
+/*
+
+	null.h
+	Null test between two inputs for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _NULL_H_
+#define _NULL_H_
+
+#include <stdio.h>
+
+
+/* Length of each residual measurement */
+#define NULL_SECS			1.0
+
+/* Programme quieter than this isn't compared */
+#define NULL_MIN_PROGRAMME	-80.0f
+
+/* Independent accumulators in the kernel, for the compiler to vectorise */
+#define NULL_LANES			8
+
+
+/*
+	Subtract the compare input from the main input, once they have
+	been lined up by the delay measurement, and meter what is left
+	relative to the programme level.
+*/
+typedef struct {
+	unsigned int size;
+	float *main, *compare;
+	unsigned int pos;
+	unsigned long total;
+
+	float *lag, *lead;
+
+	float threshold;
+	unsigned long len;
+	double residual;
+	double programme;
+	unsigned long frames;
+	int delay;
+
+	int alarm;
+	int reported;
+} null_t;
+
+
+/* size is the longest delay that can be lined up, chunk the most frames per call */
+null_t *null_new( unsigned int size, unsigned int chunk, double samplerate, float threshold );
+void null_add( null_t *n, const float *frames, unsigned int nframes, int delay, int inverted, FILE *out );
+void null_free( null_t *n );
+
+
+#endif
@@ -0,0 +1,248 @@
+/*
+
+	osc.c
+	OSC level streaming over UDP for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#include "config.h"
+#include "osc.h"
+
+
+/* Append a string, NUL terminated and padded to four bytes */
+static size_t osc_string( unsigned char *buf, size_t pos, const char *str )
+{
+	const size_t len = strlen( str ) + 1;
+
+	memset( buf + pos, 0, (len + 3) & ~3 );
+	memcpy( buf + pos, str, len );
+
+	return pos + ((len + 3) & ~3);
+}
+
+
+static void osc_int32( unsigned char *buf, size_t pos, uint32_t value )
+{
+	value = htonl( value );
+	memcpy( buf + pos, &value, 4 );
+}
+
+
+static void osc_float( unsigned char *buf, size_t pos, float value )
+{
+	uint32_t bits;
+
+	memcpy( &bits, &value, 4 );
+	osc_int32( buf, pos, bits );
+}
+
+
+/* Append a message with one float argument, returning where the float goes */
+static size_t osc_message( osc_t *osc, const char *address )
+{
+	const size_t start = osc->len;
+	size_t pos = start + 4;
+
+	pos = osc_string( osc->packet, pos, address );
+	pos = osc_string( osc->packet, pos, ",f" );
+	osc_float( osc->packet, pos, 0.0f );
+
+	// Bundle elements are preceded by their size
+	osc_int32( osc->packet, start, pos + 4 - (start + 4) );
+	osc->len = pos + 4;
+
+	return pos;
+}
+
+
+static int osc_parse( osc_t *osc, const char *spec )
+{
+	char host[256];
+
+	while (*spec) {
+		const char *colon = strchr( spec, ':' );
+		const size_t len = colon ? (size_t)(colon - spec) : 0;
+		struct addrinfo hints, *res;
+		char *end;
+		long port;
+
+		if (colon == NULL || len >= sizeof(host) || osc->count >= OSC_MAX_DEST) return -1;
+		memcpy( host, spec, len );
+		host[len] = 0;
+
+		port = strtol( colon + 1, &end, 10 );
+		if (end == colon + 1 || port < 1 || port > 65535) return -1;
+
+		memset( &hints, 0, sizeof(hints) );
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		if (getaddrinfo( len ? host : "localhost", NULL, &hints, &res )) return -1;
+		memcpy( &osc->addr[osc->count], res->ai_addr, sizeof(struct sockaddr_in) );
+		osc->addr[osc->count].sin_port = htons( port );
+		osc->count++;
+		freeaddrinfo( res );
+
+		spec = end;
+		if (*spec == ',') spec++;
+		else if (*spec) return -1;
+	}
+
+	return osc->count ? 0 : -1;
+}
+
+
+/* Send all of the bundles in one go, where the system lets us */
+static void osc_send( osc_t *osc )
+{
+	unsigned int i;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr msgs[OSC_MAX_DEST];
+	struct iovec iov;
+
+	iov.iov_base = osc->packet;
+	iov.iov_len = osc->len;
+	memset( msgs, 0, sizeof(msgs) );
+	for (i=0; i < osc->count; i++) {
+		msgs[i].msg_hdr.msg_name = &osc->addr[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	sendmmsg( osc->sock, msgs, osc->count, 0 );
+#else
+	for (i=0; i < osc->count; i++) {
+		sendto( osc->sock, osc->packet, osc->len, 0,
+			(struct sockaddr *) &osc->addr[i], sizeof(struct sockaddr_in) );
+	}
+#endif
+}
+
+
+static void *osc_thread( void *arg )
+{
+	osc_t *osc = arg;
+
+	while (osc->running) {
+		osc_level_t level;
+		float peak = 0.0f;
+		double ms = 0.0;
+		unsigned int n = 0;
+
+		usleep( 1000000 / OSC_RATE );
+
+		while (jack_ringbuffer_read( osc->rb, (char *) &level, sizeof(level) ) == sizeof(level)) {
+			if (level.peak > peak) peak = level.peak;
+			ms += level.ms;
+			n++;
+		}
+		if (n == 0) continue;
+
+		osc_float( osc->packet, osc->peak_offset, 20.0f * log10f( peak * osc->bias ) );
+		osc_float( osc->packet, osc->rms_offset, 10.0f * log10f( ms / n * osc->bias * osc->bias ) );
+		osc_send( osc );
+	}
+
+	return NULL;
+}
+
+
+osc_t *osc_new( const char *spec, double samplerate, unsigned int period, float bias )
+{
+	osc_t *osc = calloc( 1, sizeof(osc_t) );
+	unsigned int periods;
+
+	if (osc == NULL) return NULL;
+	osc->sock = -1;
+
+	if (osc_parse( osc, spec )) {
+		osc_free( osc );
+		return NULL;
+	}
+
+	// Enough for the periods between sends, several times over
+	periods = (unsigned int)(samplerate / period / OSC_RATE) + 1;
+	osc->rb = jack_ringbuffer_create( sizeof(osc_level_t) * periods * 4 );
+	osc->sock = socket( AF_INET, SOCK_DGRAM, 0 );
+	if (osc->rb == NULL || osc->sock < 0) {
+		osc_free( osc );
+		return NULL;
+	}
+
+	// Immediate time tag
+	memcpy( osc->packet, "#bundle", 8 );
+	osc_int32( osc->packet, 8, 0 );
+	osc_int32( osc->packet, 12, 1 );
+	osc->len = 16;
+	osc->peak_offset = osc_message( osc, "/jack_meter/peak" );
+	osc->rms_offset = osc_message( osc, "/jack_meter/rms" );
+	osc->bias = bias;
+
+	osc->running = 1;
+	if (pthread_create( &osc->thread, NULL, osc_thread, osc )) {
+		osc_free( osc );
+		return NULL;
+	}
+	osc->started = 1;
+
+	return osc;
+}
+
+
+/* Called from the JACK process callback */
+void osc_push( osc_t *osc, const float *in, unsigned int nframes )
+{
+	osc_level_t level = { 0.0f, 0.0f };
+	double sum = 0.0;
+	unsigned int i;
+
+	if (nframes == 0 || jack_ringbuffer_write_space( osc->rb ) < sizeof(level)) return;
+
+	for (i=0; i < nframes; i++) {
+		const float s = fabsf( in[i] );
+		if (s > level.peak) level.peak = s;
+		sum += in[i] * in[i];
+	}
+	level.ms = sum / nframes;
+
+	jack_ringbuffer_write( osc->rb, (const char *) &level, sizeof(level) );
+}
+
+
+void osc_free( osc_t *osc )
+{
+	if (osc == NULL) return;
+
+	if (osc->started) {
+		osc->running = 0;
+		pthread_join( osc->thread, NULL );
+	}
+	if (osc->rb) jack_ringbuffer_free( osc->rb );
+	if (osc->sock >= 0) close( osc->sock );
+	free( osc );
+}
@@ -0,0 +1,81 @@
+/*
+
+	osc.h
+	OSC level streaming over UDP for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _OSC_H_
+#define _OSC_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <jack/ringbuffer.h>
+
+
+#define OSC_MAX_DEST		8
+
+/* Bundles sent per second */
+#define OSC_RATE			50
+
+/* Room for the encoded bundle */
+#define OSC_PACKET_MAX		128
+
+
+/* Levels of one period, from the process callback */
+typedef struct {
+	float peak;
+	float ms;
+} osc_level_t;
+
+
+/*
+	Sends a bundle of /jack_meter/peak and /jack_meter/rms messages,
+	in dB, to each destination. The bundle is encoded once up front,
+	so only the two floats are patched in before each send, and all
+	the destinations are sent to with one system call. Sending is done
+	by a thread of its own, fed by a ring buffer from the process
+	callback, so that it doesn't wait on the display.
+*/
+typedef struct {
+	int sock;
+	unsigned int count;
+	struct sockaddr_in addr[OSC_MAX_DEST];
+
+	unsigned char packet[OSC_PACKET_MAX];
+	size_t len;
+	size_t peak_offset;
+	size_t rms_offset;
+
+	float bias;
+	jack_ringbuffer_t *rb;
+
+	pthread_t thread;
+	int started;
+	volatile int running;
+} osc_t;
+
+
+/* spec is a comma separated list of [host]:port, host defaulting to localhost */
+osc_t *osc_new( const char *spec, double samplerate, unsigned int period, float bias );
+void osc_push( osc_t *osc, const float *in, unsigned int nframes );
+void osc_free( osc_t *osc );
+
+
+#endif
@@ -0,0 +1,80 @@
+/*
+
+	peaks.c
+	Sliding window peak levels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "peaks.h"
+
+
+peaks_t *peaks_new( const char *spec, double samplerate, unsigned int block )
+{
+	peaks_t *peaks = calloc( 1, sizeof(peaks_t) );
+	unsigned int longest = 0, w;
+	int count;
+
+	if (peaks == NULL) return NULL;
+
+	count = parse_windows( spec, peaks->secs, PEAKS_MAX );
+	if (count < 0) {
+		peaks_free( peaks );
+		return NULL;
+	}
+	peaks->count = count;
+
+	// Windows are a whole number of blocks, rounded up
+	for (w=0; w < peaks->count; w++) {
+		peaks->blocks[w] = (unsigned int) ceil( peaks->secs[w] * samplerate / block );
+		if (peaks->blocks[w] > longest) longest = peaks->blocks[w];
+	}
+
+	peaks->dq = mono_deque_new( longest, 1 );
+	if (peaks->dq == NULL) {
+		peaks_free( peaks );
+		return NULL;
+	}
+
+	return peaks;
+}
+
+
+/* Called from the JACK process callback, once per block */
+void peaks_push( peaks_t *peaks, float block_peak )
+{
+	unsigned int w;
+
+	mono_deque_push( peaks->dq, block_peak );
+
+	for (w=0; w < peaks->count; w++) {
+		peaks->max[w] = mono_deque_last( peaks->dq, peaks->blocks[w] );
+	}
+}
+
+
+void peaks_free( peaks_t *peaks )
+{
+	if (peaks == NULL) return;
+
+	mono_deque_free( peaks->dq );
+	free( peaks );
+}
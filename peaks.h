@@ -0,0 +1,56 @@
+/*
+
+	peaks.h
+	Sliding window peak levels for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _PEAKS_H_
+#define _PEAKS_H_
+
+#include "window.h"
+
+
+#define PEAKS_MAX	8
+
+
+/*
+	The maximum sample over each of several sliding windows.
+	Each block's peak is pushed into a single max deque as
+	long as the longest window; the shorter windows are answered
+	from the same deque.
+*/
+typedef struct {
+	unsigned int count;
+	float secs[PEAKS_MAX];
+	unsigned int blocks[PEAKS_MAX];
+
+	mono_deque_t *dq;
+
+	/* Published by the process callback */
+	float max[PEAKS_MAX];
+} peaks_t;
+
+
+/* spec is a comma separated list of window lengths in seconds */
+peaks_t *peaks_new( const char *spec, double samplerate, unsigned int block );
+void peaks_push( peaks_t *peaks, float block_peak );
+void peaks_free( peaks_t *peaks );
+
+
+#endif
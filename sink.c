@@ -0,0 +1,349 @@
+/*
+
+	sink.c
+	Output sinks for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "sink.h"
+
+
+/* Levels of -inf dB are written as this, as JSON has no infinity */
+#define SINK_FLOOR_DB	-200.0f
+
+
+sinks_t *sinks_new()
+{
+	return calloc( 1, sizeof(sinks_t) );
+}
+
+
+/* The -n format: the levels as numbers on one line */
+static void sink_numeric( sink_t *sink, const sink_frame_t *frame )
+{
+	unsigned int i;
+
+	if (frame->band_count) {
+		for (i=0; i<frame->band_count; i++) {
+			printf("%s%1.1f", i ? " " : "", frame->band_db[i]);
+		}
+	} else {
+		printf("%1.1f", frame->db);
+	}
+	for (i=0; i<frame->peak_count; i++) {
+		printf(" %1.1f", frame->peak_db[i]);
+	}
+	for (i=0; i<frame->leq_count; i++) {
+		printf(" %1.1f", frame->leq_db[i]);
+	}
+	for (i=0; i<frame->source_count; i++) {
+		printf(" %1.1f", frame->source_db[i]);
+	}
+	printf("\n");
+}
+
+
+static float sink_db( float db )
+{
+	return (db > SINK_FLOOR_DB) ? db : SINK_FLOOR_DB;
+}
+
+
+/* A JSON string, with quotes, backslashes and control characters escaped */
+static size_t sink_json_string( char *buf, size_t size, const char *str )
+{
+	size_t len = 0;
+
+	if (len < size) buf[len] = '"';
+	len++;
+	for (; *str; str++) {
+		const unsigned char c = *str;
+
+		if (c == '"' || c == '\\') {
+			if (len + 1 < size) { buf[len] = '\\'; buf[len+1] = c; }
+			len += 2;
+		} else if (c < 0x20) {
+			if (len + 6 < size) snprintf( buf + len, 7, "\\u%04x", c );
+			len += 6;
+		} else {
+			if (len < size) buf[len] = c;
+			len++;
+		}
+	}
+	if (len < size) buf[len] = '"';
+	len++;
+	if (len < size) buf[len] = 0;
+
+	return len;
+}
+
+
+/* One JSON object per frame, without a newline */
+static int sink_json( const sink_frame_t *frame, char *buf, size_t size )
+{
+	size_t len = 0;
+	unsigned int i;
+
+	len += snprintf( buf + len, size - len, "{\"seq\":%lu,\"time\":%1.3f,\"%s\":%1.1f",
+		frame->seq, frame->time, frame->weighting ? "rms" : "peak", sink_db( frame->db ) );
+	if (frame->weighting && len < size) {
+		len += snprintf( buf + len, size - len, ",\"weighting\":\"%c\"", frame->weighting );
+	}
+	for (i=0; i<frame->band_count && len < size; i++) {
+		len += snprintf( buf + len, size - len, "%s", i ? "," : ",\"bands\":{" );
+		if (len < size) len += sink_json_string( buf + len, size - len, frame->band_label[i] );
+		if (len < size) len += snprintf( buf + len, size - len, ":%1.1f", sink_db( frame->band_db[i] ) );
+	}
+	if (frame->band_count && len < size) len += snprintf( buf + len, size - len, "}" );
+	for (i=0; i<frame->peak_count && len < size; i++) {
+		len += snprintf( buf + len, size - len, "%s\"%g\":%1.1f",
+			i ? "," : ",\"max\":{", frame->peak_secs[i], sink_db( frame->peak_db[i] ) );
+	}
+	if (frame->peak_count && len < size) len += snprintf( buf + len, size - len, "}" );
+	for (i=0; i<frame->leq_count && len < size; i++) {
+		len += snprintf( buf + len, size - len, "%s\"%g\":%1.1f",
+			i ? "," : ",\"leq\":{", frame->leq_secs[i], sink_db( frame->leq_db[i] ) );
+	}
+	if (frame->leq_count && len < size) len += snprintf( buf + len, size - len, "}" );
+	for (i=0; i<frame->source_count && len < size; i++) {
+		len += snprintf( buf + len, size - len, "%s", i ? "," : ",\"sources\":{" );
+		if (len < size) len += sink_json_string( buf + len, size - len, frame->source_name[i] );
+		if (len < size) len += snprintf( buf + len, size - len, ":%1.1f", sink_db( frame->source_db[i] ) );
+	}
+	if (frame->source_count && len < size) len += snprintf( buf + len, size - len, "}" );
+	if (len < size) len += snprintf( buf + len, size - len, "}" );
+
+	return (len < size) ? (int) len : -1;
+}
+
+
+static void sink_ndjson( sink_t *sink, const sink_frame_t *frame )
+{
+	char line[SINK_LINE_MAX];
+
+	if (sink_json( frame, line, sizeof(line) ) < 0) return;
+	fprintf(sink->file, "%s\n", line);
+	fflush( sink->file );
+}
+
+
+static void sink_udp( sink_t *sink, const sink_frame_t *frame )
+{
+	char line[SINK_LINE_MAX];
+	const int len = sink_json( frame, line, sizeof(line) );
+
+	if (len < 0) return;
+	sendto( sink->sock, line, len, 0, (struct sockaddr *) &sink->addr, sizeof(sink->addr) );
+}
+
+
+/* Odd sequence count while the frame is being written */
+static void sink_shm( sink_t *sink, const sink_frame_t *frame )
+{
+	sink_shm_t *shm = sink->shm;
+
+	unsigned int i;
+
+	shm->seq++;
+	__sync_synchronize();
+	shm->frame = *frame;
+	shm->frame.band_label = NULL;
+	shm->frame.peak_secs = NULL;
+	shm->frame.leq_secs = NULL;
+	shm->frame.source_name = NULL;
+	for (i=0; i<frame->band_count; i++) {
+		snprintf( shm->band_label[i], SINK_NAME_MAX, "%s", frame->band_label[i] );
+	}
+	for (i=0; i<frame->peak_count; i++) {
+		shm->peak_secs[i] = frame->peak_secs[i];
+	}
+	for (i=0; i<frame->leq_count; i++) {
+		shm->leq_secs[i] = frame->leq_secs[i];
+	}
+	for (i=0; i<frame->source_count; i++) {
+		snprintf( shm->source_name[i], SINK_NAME_MAX, "%s", frame->source_name[i] );
+	}
+	__sync_synchronize();
+	shm->seq++;
+}
+
+
+static void sink_alert( sink_t *sink, const sink_frame_t *frame )
+{
+	if (!sink->alarm && frame->db > sink->threshold) {
+		fprintf(stderr, "Level ALARM: %1.1fdB (threshold %1.1fdB)\n", frame->db, sink->threshold);
+		sink->alarm = 1;
+	} else if (sink->alarm && frame->db <= sink->threshold) {
+		fprintf(stderr, "Level OK: %1.1fdB\n", frame->db);
+		sink->alarm = 0;
+	}
+}
+
+
+static int sink_open_udp( sink_t *sink, const char *arg )
+{
+	const char *colon = strrchr( arg, ':' );
+	struct addrinfo hints, *res;
+	char host[256];
+	size_t len;
+
+	if (colon == NULL || (len = colon - arg) >= sizeof(host)) return -1;
+	memcpy( host, arg, len );
+	host[len] = 0;
+
+	memset( &hints, 0, sizeof(hints) );
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo( len ? host : "localhost", colon + 1, &hints, &res )) return -1;
+	memcpy( &sink->addr, res->ai_addr, sizeof(sink->addr) );
+	freeaddrinfo( res );
+
+	sink->sock = socket( AF_INET, SOCK_DGRAM, 0 );
+	return (sink->sock < 0) ? -1 : 0;
+}
+
+
+static int sink_open_shm( sink_t *sink, const char *name )
+{
+	const int fd = shm_open( name, O_RDWR | O_CREAT, 0644 );
+	void *mem;
+
+	if (fd < 0) return -1;
+	if (ftruncate( fd, sizeof(sink_shm_t) )) {
+		close( fd );
+		return -1;
+	}
+	mem = mmap( NULL, sizeof(sink_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if (mem == MAP_FAILED) return -1;
+
+	sink->shm = mem;
+	return 0;
+}
+
+
+int sinks_add( sinks_t *sinks, const char *spec, int rate )
+{
+	sink_t *sink;
+	char type[16], arg[256] = "";
+	const char *at = strrchr( spec, '@' );
+	const size_t len = at ? (size_t)(at - spec) : strlen( spec );
+	const size_t tlen = strcspn( spec, ":@" );
+	int result = -1;
+
+	if (sinks->count >= SINK_MAX || tlen >= sizeof(type) || len - tlen > sizeof(arg)) return -1;
+	memcpy( type, spec, tlen );
+	type[tlen] = 0;
+	if (len > tlen) {
+		memcpy( arg, spec + tlen + 1, len - tlen - 1 );
+		arg[len - tlen - 1] = 0;
+	}
+
+	sink = &sinks->sink[sinks->count];
+	memset( sink, 0, sizeof(sink_t) );
+	sink->sock = -1;
+
+	// Frames per second given as a decimation of the update rate
+	sink->every = 1;
+	if (at) {
+		const float per_sec = atof( at + 1 );
+		if (per_sec <= 0.0f) return -1;
+		sink->every = (per_sec < rate) ? (unsigned int) lrintf( rate / per_sec ) : 1;
+	}
+
+	if (strcmp( type, "numeric" ) == 0 && !*arg) {
+		sink->write = sink_numeric;
+		result = 0;
+	} else if (strcmp( type, "ndjson" ) == 0 && *arg) {
+		sink->write = sink_ndjson;
+		sink->file = strcmp( arg, "-" ) ? fopen( arg, "a" ) : stdout;
+		result = sink->file ? 0 : -1;
+	} else if (strcmp( type, "udp" ) == 0) {
+		sink->write = sink_udp;
+		result = sink_open_udp( sink, arg );
+	} else if (strcmp( type, "shm" ) == 0 && *arg) {
+		sink->write = sink_shm;
+		result = sink_open_shm( sink, arg );
+	} else if (strcmp( type, "alert" ) == 0 && *arg) {
+		char *end;
+		sink->write = sink_alert;
+		sink->threshold = strtof( arg, &end );
+		result = *end ? -1 : 0;
+	}
+
+	if (result == 0) sinks->count++;
+	return result;
+}
+
+
+int sinks_add_writer( sinks_t *sinks, sink_write_t write )
+{
+	sink_t *sink;
+
+	if (sinks->count >= SINK_MAX) return -1;
+
+	sink = &sinks->sink[sinks->count++];
+	memset( sink, 0, sizeof(sink_t) );
+	sink->sock = -1;
+	sink->write = write;
+	sink->every = 1;
+
+	return 0;
+}
+
+
+void sinks_write( sinks_t *sinks, const sink_frame_t *frame )
+{
+	unsigned int i;
+
+	for (i=0; i<sinks->count; i++) {
+		sink_t *sink = &sinks->sink[i];
+
+		if (sink->count++ % sink->every == 0) {
+			sink->write( sink, frame );
+		}
+	}
+}
+
+
+void sinks_free( sinks_t *sinks )
+{
+	unsigned int i;
+
+	if (sinks == NULL) return;
+
+	for (i=0; i<sinks->count; i++) {
+		sink_t *sink = &sinks->sink[i];
+
+		if (sink->file && sink->file != stdout) fclose( sink->file );
+		if (sink->sock >= 0) close( sink->sock );
+		if (sink->shm) munmap( sink->shm, sizeof(sink_shm_t) );
+	}
+	free( sinks );
+}
@@ -0,0 +1,127 @@
+/*
+
+	sink.h
+	Output sinks for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _SINK_H_
+#define _SINK_H_
+
+#include <stdio.h>
+#include <netinet/in.h>
+#include "bands.h"
+#include "peaks.h"
+#include "leq.h"
+#include "sources.h"
+
+
+#define SINK_MAX		16
+
+/* Longest line written by the NDJSON and socket sinks */
+#define SINK_LINE_MAX	2048
+
+/* Longest band label or port name kept in shared memory, with its nul */
+#define SINK_NAME_MAX	128
+
+
+/*
+	Everything measured for one update of the display. The main loop
+	fills one in and every sink is given the same one to read.
+*/
+typedef struct {
+	unsigned long seq;
+	double time;
+
+	/* Peak level, or weighted RMS level with weighting */
+	float db;
+	char weighting;
+
+	unsigned int band_count;
+	const char * const *band_label;
+	float band_db[BANDS_MAX];
+
+	unsigned int peak_count;
+	const float *peak_secs;
+	float peak_db[PEAKS_MAX];
+
+	unsigned int leq_count;
+	const float *leq_secs;
+	float leq_db[LEQ_MAX];
+
+	unsigned int source_count;
+	const char * const *source_name;
+	float source_db[SOURCES_MAX];
+} sink_frame_t;
+
+
+/*
+	Layout of the shared memory sink: frame is valid when seq is even.
+	Its pointers mean nothing to another process and are left NULL;
+	the labels and window lengths they point to are copied after it.
+*/
+typedef struct {
+	volatile unsigned int seq;
+	sink_frame_t frame;
+	char band_label[BANDS_MAX][SINK_NAME_MAX];
+	float peak_secs[PEAKS_MAX];
+	float leq_secs[LEQ_MAX];
+	char source_name[SOURCES_MAX][SINK_NAME_MAX];
+} sink_shm_t;
+
+
+typedef struct sink_s sink_t;
+typedef void (*sink_write_t)( sink_t *sink, const sink_frame_t *frame );
+
+struct sink_s {
+	sink_write_t write;
+	unsigned int every;
+	unsigned long count;
+
+	FILE *file;
+	int sock;
+	struct sockaddr_in addr;
+	sink_shm_t *shm;
+	float threshold;
+	int alarm;
+};
+
+
+typedef struct {
+	unsigned int count;
+	sink_t sink[SINK_MAX];
+} sinks_t;
+
+
+sinks_t *sinks_new();
+
+/*
+	spec is type[:arg][@rate], type being numeric, ndjson:file,
+	udp:host:port, shm:name or alert:dB, and rate the number of
+	frames per second it gets (at most rate, the update rate).
+*/
+int sinks_add( sinks_t *sinks, const char *spec, int rate );
+
+/* A sink written by the caller's own function, every frame */
+int sinks_add_writer( sinks_t *sinks, sink_write_t write );
+
+void sinks_write( sinks_t *sinks, const sink_frame_t *frame );
+void sinks_free( sinks_t *sinks );
+
+
+#endif
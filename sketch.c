@@ -0,0 +1,195 @@
+/*
+
+	sketch.c
+	Streaming quantiles of level for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sketch.h"
+
+
+void sketch_clear( sketch_t *sk )
+{
+	memset( sk, 0, sizeof(sketch_t) );
+}
+
+
+/* Move the bins up so that 'top' is the highest, collapsing the lowest ones */
+static void sketch_raise( sketch_t *sk, int top )
+{
+	const int shift = top - sk->top;
+	int i;
+
+	if (shift <= 0) return;
+
+	if (shift >= SKETCH_BINS) {
+		uint32_t total = 0;
+		for (i=0; i < SKETCH_BINS; i++) total += sk->bins[i];
+		memset( sk->bins, 0, sizeof(sk->bins) );
+		sk->bins[0] = total;
+	} else {
+		for (i=1; i <= shift; i++) sk->bins[0] += sk->bins[i];
+		memmove( sk->bins + 1, sk->bins + shift + 1, sizeof(uint32_t) * (SKETCH_BINS - shift - 1) );
+		memset( sk->bins + SKETCH_BINS - shift, 0, sizeof(uint32_t) * shift );
+	}
+
+	sk->top = top;
+}
+
+
+static void sketch_add_key( sketch_t *sk, int key, uint32_t n )
+{
+	int i;
+
+	if (sk->count == sk->silent) {
+		// First level: put it at the top
+		sk->top = key;
+	} else if (key > sk->top) {
+		sketch_raise( sk, key );
+	}
+
+	i = key - (sk->top - SKETCH_BINS + 1);
+	if (i < 0) i = 0;
+	sk->bins[i] += n;
+	sk->count += n;
+}
+
+
+void sketch_add( sketch_t *sk, float db )
+{
+	if (db < SKETCH_FLOOR) {
+		sk->silent++;
+		sk->count++;
+		return;
+	}
+
+	sketch_add_key( sk, (int) floorf( db / SKETCH_DB_PER_BIN ), 1 );
+}
+
+
+void sketch_merge( sketch_t *dst, const sketch_t *src )
+{
+	int i;
+
+	if (src->count == src->silent) {
+		dst->silent += src->silent;
+		dst->count += src->silent;
+		return;
+	}
+
+	// Add the top bin first, so the bottom of dst is where it will end up
+	for (i=SKETCH_BINS-1; i >= 0; i--) {
+		if (src->bins[i]) {
+			sketch_add_key( dst, src->top - SKETCH_BINS + 1 + i, src->bins[i] );
+		}
+	}
+	dst->silent += src->silent;
+	dst->count += src->silent;
+}
+
+
+/* Level in dB below which a fraction q of the levels lie */
+float sketch_quantile( const sketch_t *sk, float q )
+{
+	const uint32_t rank = (uint32_t)(q * (sk->count - 1));
+	uint32_t seen = sk->silent;
+	int i;
+
+	if (sk->count == 0 || rank < seen) return -INFINITY;
+
+	for (i=0; i < SKETCH_BINS; i++) {
+		seen += sk->bins[i];
+		if (seen > rank) break;
+	}
+
+	// Middle of the bin
+	return (sk->top - SKETCH_BINS + 1 + i + 0.5f) * SKETCH_DB_PER_BIN;
+}
+
+
+sketch_history_t *sketch_history_new( void )
+{
+	return calloc( 1, sizeof(sketch_history_t) );
+}
+
+
+void sketch_history_add( sketch_history_t *hist, float db )
+{
+	sketch_add( &hist->minute, db );
+	if (++hist->seconds < 60) return;
+
+	// The minute is complete
+	hist->minute_ring[hist->minutes % 60] = hist->minute;
+	sketch_clear( &hist->minute );
+	hist->seconds = 0;
+
+	if (++hist->minutes % 60 == 0) {
+		sketch_t *hour = &hist->hour_ring[hist->hours % 24];
+		int i;
+
+		sketch_clear( hour );
+		for (i=0; i < 60; i++) sketch_merge( hour, &hist->minute_ring[i] );
+		hist->hours++;
+	}
+}
+
+
+static void report_line( const char *name, const sketch_t *sk, FILE *out )
+{
+	fprintf(out, "  %-12s P10 %6.1fdB  P50 %6.1fdB  P95 %6.1fdB  (%u seconds)\n", name,
+		sketch_quantile( sk, 0.10f ), sketch_quantile( sk, 0.50f ), sketch_quantile( sk, 0.95f ), sk->count);
+}
+
+
+void sketch_history_report( sketch_history_t *hist, FILE *out )
+{
+	const unsigned int this_hour = hist->minutes % 60;
+	sketch_t hour, day;
+	unsigned int i;
+
+	// This minute and the 59 before it
+	hour = hist->minute;
+	for (i=0; i < 59 && i < hist->minutes; i++) {
+		sketch_merge( &hour, &hist->minute_ring[ (hist->minutes - 1 - i) % 60 ] );
+	}
+
+	// This hour so far and the 23 complete hours before it
+	day = hist->minute;
+	for (i=0; i < this_hour; i++) {
+		sketch_merge( &day, &hist->minute_ring[ (hist->minutes - 1 - i) % 60 ] );
+	}
+	for (i=0; i < 23 && i < hist->hours; i++) {
+		sketch_merge( &day, &hist->hour_ring[ (hist->hours - 1 - i) % 24 ] );
+	}
+
+	fprintf(out, "Level distribution (%gs RMS):\n", SKETCH_SECS);
+	report_line( "this minute", &hist->minute, out );
+	report_line( "last hour", &hour, out );
+	report_line( "last day", &day, out );
+}
+
+
+void sketch_history_free( sketch_history_t *hist )
+{
+	free( hist );
+}
@@ -0,0 +1,85 @@
+/*
+
+	sketch.h
+	Streaming quantiles of level for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _SKETCH_H_
+#define _SKETCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+/* Bins are this wide, so quantiles are within a quarter of a dB */
+#define SKETCH_DB_PER_BIN	0.5f
+
+/* 128 bins cover 64dB; anything further below the loudest is lumped together */
+#define SKETCH_BINS			128
+
+/* Levels below this count as silence */
+#define SKETCH_FLOOR		-140.0f
+
+/* Length of each level measurement that goes into the sketches */
+#define SKETCH_SECS			1.0
+
+
+/*
+	A DDSketch style quantile sketch of levels in dB. Equal width bins
+	in dB are bins of equal relative width in power, so the error is
+	relative. Memory is fixed: when levels span more than the bins
+	can hold, the lowest bins are collapsed into one, which keeps the
+	upper quantiles accurate.
+*/
+typedef struct {
+	int top;
+	uint32_t silent;
+	uint32_t count;
+	uint32_t bins[SKETCH_BINS];
+} sketch_t;
+
+
+void sketch_clear( sketch_t *sk );
+void sketch_add( sketch_t *sk, float db );
+void sketch_merge( sketch_t *dst, const sketch_t *src );
+float sketch_quantile( const sketch_t *sk, float q );
+
+
+/*
+	Sketches for each minute in the last hour and each hour in the
+	last day, merged as needed to answer questions over either span.
+*/
+typedef struct {
+	unsigned int seconds;
+	unsigned int minutes;
+	unsigned long hours;
+
+	sketch_t minute;
+	sketch_t minute_ring[60];
+	sketch_t hour_ring[24];
+} sketch_history_t;
+
+
+sketch_history_t *sketch_history_new( void );
+void sketch_history_add( sketch_history_t *hist, float db );
+void sketch_history_report( sketch_history_t *hist, FILE *out );
+void sketch_history_free( sketch_history_t *hist );
+
+
+#endif
@@ -0,0 +1,133 @@
+/*
+
+	sources.c
+	Per-source levels of the mixed input for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "sources.h"
+
+
+sources_t *sources_new( unsigned int period )
+{
+	sources_t *sources = calloc( 1, sizeof(sources_t) );
+
+	if (sources == NULL) return NULL;
+
+	sources->len = period;
+	sources->mix = calloc( period, sizeof(float) );
+	if (sources->mix == NULL) {
+		sources_free( sources );
+		return NULL;
+	}
+
+	return sources;
+}
+
+
+int sources_add( sources_t *sources, const char *name )
+{
+	if (sources->count >= SOURCES_MAX) return -1;
+
+	sources->name[sources->count++] = name;
+
+	return 0;
+}
+
+
+/*
+	Add b into mix, and return the highest sample of b.
+	The peak is kept in separate lanes so that the compiler can
+	vectorise the loop along with the sum. It compares the bit
+	patterns with the sign bit cleared, which sort in the same
+	order as the magnitudes, because a float max doesn't vectorise.
+*/
+static float sources_kernel( float * restrict mix, const float * restrict b, unsigned int len )
+{
+	uint32_t p[SOURCES_LANES] = { 0 }, peak = 0;
+	unsigned int i, l;
+	float f;
+
+	for (i=0; i + SOURCES_LANES <= len; i += SOURCES_LANES) {
+		for (l=0; l < SOURCES_LANES; l++) {
+			uint32_t u;
+			memcpy( &u, &b[i+l], sizeof(u) );
+			u &= 0x7fffffff;
+			mix[i+l] += b[i+l];
+			p[l] = (u > p[l]) ? u : p[l];
+		}
+	}
+	for (; i < len; i++) {
+		uint32_t u;
+		memcpy( &u, &b[i], sizeof(u) );
+		u &= 0x7fffffff;
+		mix[i] += b[i];
+		if (u > p[0]) p[0] = u;
+	}
+
+	for (l=0; l < SOURCES_LANES; l++) {
+		if (p[l] > peak) peak = p[l];
+	}
+
+	memcpy( &f, &peak, sizeof(f) );
+	return f;
+}
+
+
+const float *sources_mix( sources_t *sources, const float *in, const float * const *buffers, unsigned int nframes )
+{
+	unsigned int s;
+
+	if (nframes > sources->len) return in;
+
+	memcpy( sources->mix, in, sizeof(float) * nframes );
+
+	for (s=0; s < sources->count; s++) {
+		const float peak = sources_kernel( sources->mix, buffers[s], nframes );
+		if (peak > sources->peak[s]) sources->peak[s] = peak;
+	}
+
+	return sources->mix;
+}
+
+
+void sources_read( sources_t *sources, float bias, float *db )
+{
+	unsigned int s;
+
+	for (s=0; s < sources->count; s++) {
+		const float peak = sources->peak[s];
+		sources->peak[s] = 0.0f;
+		db[s] = 20.0f * log10f( peak * bias );
+	}
+}
+
+
+void sources_free( sources_t *sources )
+{
+	if (sources == NULL) return;
+
+	free( sources->mix );
+	free( sources );
+}
@@ -0,0 +1,65 @@
+/*
+
+	sources.h
+	Per-source levels of the mixed input for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _SOURCES_H_
+#define _SOURCES_H_
+
+
+#define SOURCES_MAX		16
+
+/* Peaks are kept in this many lanes while mixing */
+#define SOURCES_LANES	8
+
+
+/*
+	Each source has an input of its own instead of all of them being
+	connected to the one input, and they are mixed here instead of by
+	JACK. The mix is worked out a source at a time over the whole
+	period, which the compiler turns into SIMD code, and each source's
+	peak is found in the same pass.
+*/
+typedef struct {
+	unsigned int count;
+	const char *name[SOURCES_MAX];
+
+	float *mix;
+	unsigned int len;
+
+	/* Highest sample of each source since the main loop last read it */
+	float peak[SOURCES_MAX];
+} sources_t;
+
+
+sources_t *sources_new( unsigned int period );
+
+/* Name is the port the source comes from, and is kept, not copied */
+int sources_add( sources_t *sources, const char *name );
+
+/* Called from the JACK process callback: in is the meter's own input, added to the mix */
+const float *sources_mix( sources_t *sources, const float *in, const float * const *buffers, unsigned int nframes );
+
+/* Read and reset the peak level of each source, in dB */
+void sources_read( sources_t *sources, float bias, float *db );
+void sources_free( sources_t *sources );
+
+
+#endif
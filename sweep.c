@@ -0,0 +1,271 @@
+/*
+
+	sweep.c
+	Swept-sine frequency response measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sweep.h"
+
+
+/* Smallest power of two at least n */
+static unsigned long pow2( unsigned long n )
+{
+	unsigned long size = 1;
+	while (size < n) size <<= 1;
+	return size;
+}
+
+
+sweep_t *sweep_new( double samplerate, double secs )
+{
+	const float level = powf( 10.0f, SWEEP_LEVEL * 0.05f );
+	sweep_t *sweep;
+	unsigned long i, size, ir_size, fade;
+	double rate, max = 0.0;
+
+	if (secs <= 0.0) return NULL;
+
+	sweep = calloc( 1, sizeof(sweep_t) );
+	if (sweep == NULL) return NULL;
+
+	sweep->samplerate = samplerate;
+	sweep->start = SWEEP_START;
+	sweep->end = fmin( SWEEP_END, samplerate * 0.45 );
+	sweep->sweep_len = (unsigned long)(samplerate * secs);
+	sweep->capture_len = sweep->sweep_len + (unsigned long)(samplerate * SWEEP_TAIL_SECS);
+
+	// Room for the distortion products either side of the impulse
+	size = pow2( sweep->capture_len + sweep->sweep_len );
+	ir_size = pow2( samplerate * (SWEEP_PRE_SECS + SWEEP_IR_SECS) );
+
+	sweep->sweep = malloc( sizeof(float) * sweep->sweep_len );
+	sweep->capture = calloc( sweep->capture_len, sizeof(float) );
+	sweep->fft = fft_new( size );
+	sweep->inverse = malloc( sizeof(float complex) * size );
+	sweep->work = malloc( sizeof(float complex) * size );
+	sweep->ir_fft = fft_new( ir_size );
+	sweep->ir = malloc( sizeof(float complex) * ir_size );
+	if (!sweep->sweep || !sweep->capture || !sweep->fft || !sweep->inverse ||
+	    !sweep->work || !sweep->ir_fft || !sweep->ir) {
+		sweep_free( sweep );
+		return NULL;
+	}
+
+	// Frequency rises exponentially: f(t) = start.exp(t / rate)
+	rate = secs / log( sweep->end / sweep->start );
+	fade = (unsigned long)(samplerate * SWEEP_FADE_SECS);
+	for (i=0; i < sweep->sweep_len; i++) {
+		const double t = i / samplerate;
+		double s = level * sin( 2.0 * M_PI * sweep->start * rate * (exp( t / rate ) - 1.0) );
+
+		if (i < fade) s *= 0.5 - 0.5 * cos( M_PI * i / fade );
+		if (sweep->sweep_len - i < fade) s *= 0.5 - 0.5 * cos( M_PI * (sweep->sweep_len - i) / fade );
+		sweep->sweep[i] = s;
+	}
+
+	// Regularised inverse, so that noise outside the sweep isn't amplified
+	for (i=0; i < size; i++) {
+		sweep->inverse[i] = (i < sweep->sweep_len) ? sweep->sweep[i] : 0.0f;
+	}
+	fft_forward( sweep->fft, sweep->inverse );
+	for (i=0; i < size; i++) {
+		const double p = crealf( sweep->inverse[i] * conjf( sweep->inverse[i] ) );
+		if (p > max) max = p;
+	}
+	for (i=0; i < size; i++) {
+		const float complex x = sweep->inverse[i];
+		sweep->inverse[i] = conjf( x ) / (crealf( x * conjf( x ) ) + max * 1e-4f);
+	}
+
+	return sweep;
+}
+
+
+/* Called from the JACK process callback */
+void sweep_process( sweep_t *sweep, const float *in, float *out, unsigned int nframes )
+{
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		float o = 0.0f;
+
+		// Sample 0 of the recording is the same frame as sample 0 of the sweep
+		if (sweep->state == SWEEP_PLAY) {
+			if (sweep->pos < sweep->sweep_len) o = sweep->sweep[sweep->pos];
+			sweep->capture[sweep->pos] = in[i];
+			if (++sweep->pos >= sweep->capture_len) {
+				sweep->state = SWEEP_DONE;
+			}
+		}
+		out[i] = o;
+	}
+}
+
+
+/* Draw the response as a graph, log frequency across and dB down */
+static void sweep_plot( sweep_t *sweep, const float *db, int cols, FILE *out )
+{
+	const double marks[] = { 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0, 10000.0, 20000.0 };
+	const char *labels[] = { "20", "50", "100", "200", "500", "1k", "2k", "5k", "10k", "20k" };
+	const double octaves = log( sweep->end / sweep->start );
+	char *line = malloc( cols + 1 );
+	float top = -1000.0f;
+	int row, c;
+	unsigned int m;
+
+	if (line == NULL) return;
+
+	for (c=0; c < cols; c++) {
+		if (db[c] > top) top = db[c];
+	}
+	top = SWEEP_PLOT_STEP * ceilf( top / SWEEP_PLOT_STEP ) + 0.0f;
+
+	for (row=0; row < SWEEP_PLOT_ROWS; row++) {
+		const float level = top - row * SWEEP_PLOT_STEP;
+
+		for (c=0; c < cols; c++) {
+			if (db[c] >= level - SWEEP_PLOT_STEP * 0.5f && db[c] < level + SWEEP_PLOT_STEP * 0.5f) {
+				line[c] = '*';
+			} else {
+				line[c] = (level == 0.0f) ? '-' : ' ';
+			}
+		}
+		line[cols] = 0;
+		fprintf(out, "%+4.0f %s\n", level, line);
+	}
+
+	// Frequency labels along the bottom
+	memset( line, ' ', cols );
+	for (m=0; m < sizeof(marks) / sizeof(marks[0]); m++) {
+		const int len = strlen( labels[m] );
+		int pos;
+
+		if (marks[m] < sweep->start || marks[m] > sweep->end) continue;
+		pos = (int)(cols * log( marks[m] / sweep->start ) / octaves) - len / 2;
+		if (pos < 0) pos = 0;
+		if (pos + len > cols) pos = cols - len;
+		memcpy( line + pos, labels[m], len );
+	}
+	fprintf(out, "     %s\n", line);
+
+	free( line );
+}
+
+
+/* Called from the main loop: if a recording is ready, work out and draw the response */
+void sweep_analyse( sweep_t *sweep, int width, FILE *out )
+{
+	const unsigned long size = sweep->fft->size;
+	const unsigned long ir_size = sweep->ir_fft->size;
+	const unsigned long pre = (unsigned long)(sweep->samplerate * SWEEP_PRE_SECS);
+	const unsigned long fade = ir_size / 4;
+	const int cols = width - 5;
+	float complex *work = sweep->work;
+	float *db;
+	float best = 0.0f;
+	unsigned long i, peak = 0;
+	int c;
+
+	if (sweep->state != SWEEP_DONE) return;
+
+	// Impulse response is the recording convolved with the inverse sweep
+	for (i=0; i < size; i++) {
+		work[i] = (i < sweep->capture_len) ? sweep->capture[i] : 0.0f;
+	}
+	fft_forward( sweep->fft, work );
+	for (i=0; i < size; i++) {
+		const float complex x = work[i], y = sweep->inverse[i];
+		work[i] = CMPLXF( crealf(x) * crealf(y) - cimagf(x) * cimagf(y),
+		                  crealf(x) * cimagf(y) + cimagf(x) * crealf(y) );
+	}
+	fft_inverse( sweep->fft, work );
+
+	// The recording can be used again now
+	sweep->pos = 0;
+	sweep->state = SWEEP_PLAY;
+
+	// Linear response starts at the peak; anything before it is distortion
+	for (i=0; i < sweep->capture_len; i++) {
+		const float s = fabsf( crealf( work[i] ) );
+		if (s > best) {
+			best = s;
+			peak = i;
+		}
+	}
+	if (best == 0.0f) {
+		fprintf(out, "Sweep: nothing recorded\n");
+		return;
+	}
+
+	// Window from just before the peak, fading out at the end
+	for (i=0; i < ir_size; i++) {
+		const unsigned long j = (peak + size - pre + i) % size;
+		float s = crealf( work[j] );
+
+		if (i < pre) s *= 0.5f - 0.5f * cosf( M_PI * i / pre );
+		if (ir_size - i < fade) s *= 0.5f - 0.5f * cosf( M_PI * (ir_size - i) / fade );
+		sweep->ir[i] = s;
+	}
+	fft_forward( sweep->ir_fft, sweep->ir );
+
+	// Average the power into columns evenly spaced in log frequency
+	if (cols < 10) return;
+	db = malloc( sizeof(float) * cols );
+	if (db == NULL) return;
+	for (c=0; c < cols; c++) {
+		const double f1 = sweep->start * pow( sweep->end / sweep->start, (double) c / cols );
+		const double f2 = sweep->start * pow( sweep->end / sweep->start, (double) (c + 1) / cols );
+		unsigned long k1 = (unsigned long)(f1 * ir_size / sweep->samplerate + 0.5);
+		unsigned long k2 = (unsigned long)(f2 * ir_size / sweep->samplerate + 0.5);
+		double sum = 0.0;
+		unsigned long k;
+
+		if (k2 <= k1) k2 = k1 + 1;
+		for (k=k1; k < k2; k++) {
+			sum += crealf( sweep->ir[k] * conjf( sweep->ir[k] ) );
+		}
+		db[c] = 10.0f * log10f( sum / (k2 - k1) + 1e-20 );
+	}
+
+	fprintf(out, "Sweep: latency %lu samples (%1.2fms), response from %gHz to %gHz:\n",
+		peak, 1000.0 * peak / sweep->samplerate, sweep->start, sweep->end);
+	sweep_plot( sweep, db, cols, out );
+
+	free( db );
+}
+
+
+void sweep_free( sweep_t *sweep )
+{
+	if (sweep == NULL) return;
+
+	free( sweep->sweep );
+	free( sweep->capture );
+	fft_free( sweep->fft );
+	free( sweep->inverse );
+	free( sweep->work );
+	fft_free( sweep->ir_fft );
+	free( sweep->ir );
+	free( sweep );
+}
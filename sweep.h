@@ -0,0 +1,91 @@
+/*
+
+	sweep.h
+	Swept-sine frequency response measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include <stdio.h>
+#include "fft.h"
+
+
+/* Exponential sweep, at this level */
+#define SWEEP_START			20.0
+#define SWEEP_END			20000.0
+#define SWEEP_LEVEL			-12.0f
+#define SWEEP_SECS			10.0
+
+/* Fade in and out, so that the ends don't click */
+#define SWEEP_FADE_SECS		0.01
+
+/* Recording carries on after the sweep for the latency and decay */
+#define SWEEP_TAIL_SECS		1.0
+
+/* Part of the impulse response used for the frequency response */
+#define SWEEP_PRE_SECS		0.002
+#define SWEEP_IR_SECS		0.2
+
+/* Rows of the plot, and dB per row */
+#define SWEEP_PLOT_ROWS		12
+#define SWEEP_PLOT_STEP		3
+
+
+enum { SWEEP_PLAY = 0, SWEEP_DONE };
+
+
+/*
+	Plays an exponential sine sweep and records the input from the
+	same frame onwards, in the process callback. Once the recording
+	is full the main loop deconvolves it with the sweep, using the
+	inverse spectrum worked out up front, which leaves the impulse
+	response of the chain. Harmonic distortion ends up before the
+	impulse, so the window around its peak is just the linear part;
+	that is transformed again for the frequency response.
+*/
+typedef struct {
+	double samplerate;
+	double start, end;
+
+	float *sweep;
+	unsigned long sweep_len;
+	float *capture;
+	unsigned long capture_len;
+
+	/* Set to SWEEP_DONE by the process callback, back by the main loop */
+	volatile int state;
+	unsigned long pos;
+
+	fft_t *fft;
+	float complex *inverse;
+	float complex *work;
+
+	fft_t *ir_fft;
+	float complex *ir;
+} sweep_t;
+
+
+sweep_t *sweep_new( double samplerate, double secs );
+void sweep_process( sweep_t *sweep, const float *in, float *out, unsigned int nframes );
+void sweep_analyse( sweep_t *sweep, int width, FILE *out );
+void sweep_free( sweep_t *sweep );
+
+
+#endif
@@ -0,0 +1,188 @@
+/*
+
+	thd.c
+	THD+N measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "thd.h"
+
+
+enum { THD_STAGE_LOW = 0, THD_STAGE_HIGH, THD_STAGE_NOTCH, THD_STAGES };
+
+
+thd_t *thd_new( double samplerate, double fixed_freq )
+{
+	const double wl = biquad_prewarp( THD_LOW_HZ, samplerate );
+	const double wh = biquad_prewarp( fmin( THD_HIGH_HZ, samplerate * 0.45 ), samplerate );
+	const biquad_coeffs_t through = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+	biquad_coeffs_t c;
+	thd_t *thd = calloc( 1, sizeof(thd_t) );
+	unsigned int i, lane;
+
+	if (thd == NULL) return NULL;
+
+	thd->samplerate = samplerate;
+	thd->fixed_freq = fixed_freq;
+	thd->len = (unsigned long)(samplerate * THD_SECS);
+	thd->fft = fft_new( THD_FFT_SIZE );
+	thd->history = calloc( THD_FFT_SIZE, sizeof(float) );
+	thd->window = malloc( sizeof(float) * THD_FFT_SIZE );
+	thd->spectrum = malloc( sizeof(float complex) * THD_FFT_SIZE );
+	thd->bank = biquad_bank_new( 2, THD_STAGES );
+	if (!thd->fft || !thd->history || !thd->window || !thd->spectrum || !thd->bank) {
+		thd_free( thd );
+		return NULL;
+	}
+
+	for (i=0; i < THD_FFT_SIZE; i++) {
+		thd->window[i] = 0.5f - 0.5f * cosf( 2.0f * M_PI * i / THD_FFT_SIZE );
+	}
+
+	// Second order Butterworth high-pass and low-pass on both lanes
+	for (lane=0; lane < 2; lane++) {
+		biquad_bilinear( 1.0, 0.0, 0.0, 1.0, wl * M_SQRT2, wl * wl, samplerate, &c );
+		biquad_bank_set( thd->bank, lane, THD_STAGE_LOW, &c );
+		biquad_bilinear( 0.0, 0.0, wh * wh, 1.0, wh * M_SQRT2, wh * wh, samplerate, &c );
+		biquad_bank_set( thd->bank, lane, THD_STAGE_HIGH, &c );
+	}
+	biquad_bank_set( thd->bank, 0, THD_STAGE_NOTCH, &through );
+	biquad_bank_set( thd->bank, 1, THD_STAGE_NOTCH, &through );
+
+	return thd;
+}
+
+
+/* Frequency of the biggest peak in the spectrum, interpolated between bins */
+static double thd_find_fundamental( thd_t *thd )
+{
+	const unsigned int size = THD_FFT_SIZE;
+	unsigned int i, peak = 1;
+	float best = 0.0f, a, b, c, offset = 0.0f;
+
+	for (i=0; i < size; i++) {
+		thd->spectrum[i] = thd->history[ (thd->pos + i) % size ] * thd->window[i];
+	}
+	fft_forward( thd->fft, thd->spectrum );
+
+	for (i=1; i < size / 2 - 1; i++) {
+		const float mag = cabsf( thd->spectrum[i] );
+		if (mag > best) {
+			best = mag;
+			peak = i;
+		}
+	}
+
+	// For a Hann window the ratio of the two biggest bins gives the offset exactly
+	a = cabsf( thd->spectrum[peak-1] );
+	b = cabsf( thd->spectrum[peak] );
+	c = cabsf( thd->spectrum[peak+1] );
+	if (c > a) {
+		offset = (2.0f * c - b) / (b + c);
+	} else if (a > 0.0f) {
+		offset = -(2.0f * a - b) / (b + a);
+	}
+
+	return (peak + offset) * thd->samplerate / size;
+}
+
+
+/* Move the notch on the second lane to freq */
+static void thd_tune( thd_t *thd, double freq )
+{
+	const double w0 = biquad_prewarp( freq, thd->samplerate );
+	biquad_coeffs_t c;
+
+	biquad_bilinear( 1.0, 0.0, w0 * w0, 1.0, w0 / THD_NOTCH_Q, w0 * w0, thd->samplerate, &c );
+	biquad_bank_set( thd->bank, 1, THD_STAGE_NOTCH, &c );
+	thd->notch_freq = freq;
+}
+
+
+static void thd_measure( thd_t *thd, FILE *out )
+{
+	const double ratio = (thd->signal > 0.0) ? sqrt( thd->residual / thd->signal ) : 0.0;
+
+	// The first block is just to let the filters settle
+	if (thd->blocks++ > 0 && ratio > 0.0 && out != NULL) {
+		fprintf(out, "THD+N: %1.1fdB (%1.4f%%) at %1.1fHz\n",
+			20.0 * log10( ratio ), 100.0 * ratio, thd->notch_freq);
+	}
+
+	thd->signal = thd->residual = 0.0;
+	thd->frames = 0;
+}
+
+
+/* Called from the main loop with the latest samples from the input */
+void thd_add( thd_t *thd, const float *in, unsigned int nframes, FILE *out )
+{
+	biquad_bank_t *bank = thd->bank;
+	unsigned int i;
+
+	for (i=0; i < nframes; i++) {
+		thd->history[thd->pos] = in[i];
+		thd->pos = (thd->pos + 1) % THD_FFT_SIZE;
+		thd->total++;
+
+		// Until the notch has been tuned there is nothing to measure
+		if (thd->notch_freq == 0.0) {
+			if (thd->fixed_freq > 0.0) {
+				thd_tune( thd, thd->fixed_freq );
+			} else if (thd->total >= THD_FFT_SIZE) {
+				thd_tune( thd, thd_find_fundamental( thd ) );
+			} else {
+				continue;
+			}
+		}
+
+		bank->x[0] = bank->x[1] = in[i];
+		biquad_bank_tick( bank );
+		thd->signal += bank->x[0] * bank->x[0];
+		thd->residual += bank->x[1] * bank->x[1];
+
+		if (++thd->frames >= thd->len) {
+			thd_measure( thd, out );
+
+			// Follow the fundamental if it moves
+			if (thd->fixed_freq == 0.0) {
+				const double freq = thd_find_fundamental( thd );
+				if (fabs( freq - thd->notch_freq ) > thd->notch_freq * THD_RETUNE) {
+					thd_tune( thd, freq );
+				}
+			}
+		}
+	}
+}
+
+
+void thd_free( thd_t *thd )
+{
+	if (thd == NULL) return;
+
+	fft_free( thd->fft );
+	free( thd->history );
+	free( thd->window );
+	free( thd->spectrum );
+	biquad_bank_free( thd->bank );
+	free( thd );
+}
@@ -0,0 +1,86 @@
+/*
+
+	thd.h
+	THD+N measurement for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _THD_H_
+#define _THD_H_
+
+#include <stdio.h>
+#include "biquad.h"
+#include "fft.h"
+
+
+/* Length of each measurement */
+#define THD_SECS		1.0
+
+/* FFT used to find the fundamental */
+#define THD_FFT_SIZE	32768
+
+/* Q of the notch that removes the fundamental: narrow enough to leave
+   the second harmonic and the noise near the tone in the residual */
+#define THD_NOTCH_Q		30.0
+
+/* Relative change of the fundamental that retunes the notch; at this Q
+   a tuning error e leaves about 2 * Q * e of the tone, -104dB here */
+#define THD_RETUNE		1e-7
+
+/* Measurement bandwidth */
+#define THD_LOW_HZ		20.0
+#define THD_HIGH_HZ		20000.0
+
+
+/*
+	Total harmonic distortion plus noise: the fundamental is found,
+	a notch filter is tuned to it, and what is left is compared with
+	the whole signal. Both are band limited by the same filters; they
+	run as two lanes of one bank, the second with the notch on the end.
+*/
+typedef struct {
+	double samplerate;
+
+	fft_t *fft;
+	float *history;
+	float *window;
+	float complex *spectrum;
+	unsigned int pos;
+	unsigned long total;
+
+	biquad_bank_t *bank;
+	double fixed_freq;
+	double notch_freq;
+
+	double signal;
+	double residual;
+	unsigned long frames;
+	unsigned long len;
+	int blocks;
+} thd_t;
+
+
+/* fixed_freq is the frequency of our own generator, or 0 to find it */
+thd_t *thd_new( double samplerate, double fixed_freq );
+
+/* Each measurement is printed to out, if it isn't NULL */
+void thd_add( thd_t *thd, const float *in, unsigned int nframes, FILE *out );
+void thd_free( thd_t *thd );
+
+
+#endif
@@ -0,0 +1,199 @@
+/*
+
+	tones.c
+	Goertzel tone and mains hum detection for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "tones.h"
+
+
+enum { TONE_ABSENT = 0, TONE_PRESENT, TONE_WRONG_LEVEL };
+
+
+tones_t *tones_new( double samplerate )
+{
+	tones_t *tones = calloc( 1, sizeof(tones_t) );
+
+	if (tones == NULL) return NULL;
+	tones->samplerate = samplerate;
+	tones->len = (unsigned long)(samplerate * TONES_BLOCK_SECS);
+
+	return tones;
+}
+
+
+static int add_tone( tones_t *tones, double freq, float level )
+{
+	const double samplerate = tones->samplerate;
+
+	if (tones->count >= TONES_MAX) return -1;
+	if (freq <= 0.0 || freq >= samplerate / 2) return -1;
+
+	tones->freq[tones->count] = freq;
+	tones->expect[tones->count] = level;
+	tones->coeff[tones->count] = 2.0 * cos( 2.0 * M_PI * freq / samplerate );
+	tones->count++;
+
+	return 0;
+}
+
+
+/* The hum filters must be added before any line-up tones */
+int tones_add_hum( tones_t *tones, double mains )
+{
+	int h;
+
+	if (tones->count != 0) return -1;
+
+	for (h=1; h <= TONES_HUM_HARMONICS; h++) {
+		if (add_tone( tones, mains * h, 0.0f )) return -1;
+	}
+	for (h=1; h <= TONES_HUM_HARMONICS; h++) {
+		if (add_tone( tones, mains * (h + 0.5), 0.0f )) return -1;
+	}
+	tones->hum_count = TONES_HUM_HARMONICS;
+
+	return 0;
+}
+
+
+int tones_add_lineup( tones_t *tones, double freq, float level )
+{
+	return add_tone( tones, freq, level );
+}
+
+
+/* Called from the JACK process callback */
+void tones_process( tones_t *tones, const float *in, unsigned int nframes )
+{
+	double * restrict s1 = tones->s1;
+	double * restrict s2 = tones->s2;
+	const double * restrict coeff = tones->coeff;
+	unsigned int i, l;
+
+	for (i=0; i < nframes; i++) {
+		const double x = in[i];
+
+		// Every lane up to TONES_MAX, so the loop has a fixed trip count
+		for (l=0; l < TONES_MAX; l++) {
+			const double s = x + coeff[l] * s1[l] - s2[l];
+			s2[l] = s1[l];
+			s1[l] = s;
+		}
+		tones->energy += x * x;
+
+		if (++tones->pos >= tones->len) {
+			for (l=0; l < tones->count; l++) {
+				tones->power[l] = s1[l] * s1[l] + s2[l] * s2[l] - coeff[l] * s1[l] * s2[l];
+				s1[l] = s2[l] = 0.0;
+			}
+			tones->total = tones->energy;
+			tones->energy = 0.0;
+			tones->pos = 0;
+			tones->seq++;
+		}
+	}
+}
+
+
+/* Peak level in dB of the sine wave that gives a Goertzel power */
+static float tone_level( tones_t *tones, double power, float bias )
+{
+	return 20.0f * log10f( 2.0 * sqrt( power ) / tones->len * bias );
+}
+
+
+/* Print any changes since the last complete block */
+void tones_report( tones_t *tones, float bias, FILE *out )
+{
+	double power[TONES_MAX], total;
+	unsigned int i;
+
+	if (tones->seen == tones->seq) return;
+	tones->seen = tones->seq;
+
+	for (i=0; i < tones->count; i++) power[i] = tones->power[i];
+	total = tones->total;
+	if (total <= 0.0) total = 1e-20;
+
+	// Hum: are the mains harmonics together loud, and well above the noise between them?
+	if (tones->hum_count) {
+		double hum_power = 0.0, floor_power = 0.0;
+		float level, floor_level;
+		int state;
+
+		for (i=0; i < tones->hum_count; i++) {
+			hum_power += power[i];
+			floor_power += power[tones->hum_count + i];
+		}
+		level = tone_level( tones, hum_power, bias );
+		floor_level = tone_level( tones, floor_power, bias );
+		state = (level > TONES_HUM_THRESHOLD && level > floor_level + TONES_HUM_MARGIN);
+
+		if (state && !tones->hum_state) {
+			const char *sep = " (";
+
+			fprintf(out, "Hum detected at %gHz: %1.1fdB", tones->freq[0], level);
+			for (i=0; i < tones->hum_count; i++) {
+				const float hlevel = tone_level( tones, power[i], bias );
+				if (hlevel > TONES_HUM_THRESHOLD) {
+					fprintf(out, "%s%gHz: %1.1fdB", sep, tones->freq[i], hlevel);
+					sep = ", ";
+				}
+			}
+			fprintf(out, "%s\n", (sep[0] == ',') ? ")" : "");
+		} else if (!state && tones->hum_state) {
+			fprintf(out, "Hum at %gHz has gone\n", tones->freq[0]);
+		}
+		tones->hum_state = state;
+	}
+
+	// Line-up tones: should be nearly all of the energy and at the right level
+	for (i=tones->hum_count * 2; i < tones->count; i++) {
+		const float level = tone_level( tones, power[i], bias );
+		const double ms = 2.0 * power[i] / ((double) tones->len * tones->len);
+		int state = TONE_ABSENT;
+
+		if (ms * tones->len / total > 0.9) {
+			state = (fabsf( level - tones->expect[i] ) <= TONES_TOLERANCE) ? TONE_PRESENT : TONE_WRONG_LEVEL;
+		}
+
+		if (state != tones->state[i]) {
+			if (state == TONE_PRESENT) {
+				fprintf(out, "Line-up tone %gHz detected: %1.1fdB\n", tones->freq[i], level);
+			} else if (state == TONE_WRONG_LEVEL) {
+				fprintf(out, "Line-up tone %gHz at wrong level: %1.1fdB (expected %1.1fdB)\n",
+					tones->freq[i], level, tones->expect[i]);
+			} else {
+				fprintf(out, "Line-up tone %gHz has gone\n", tones->freq[i]);
+			}
+			tones->state[i] = state;
+		}
+	}
+}
+
+
+void tones_free( tones_t *tones )
+{
+	free( tones );
+}
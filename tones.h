@@ -0,0 +1,84 @@
+/*
+
+	tones.h
+	Goertzel tone and mains hum detection for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _TONES_H_
+#define _TONES_H_
+
+#include <stdio.h>
+
+
+/* Most filters in the bank, a multiple of 4 so the lanes vectorise */
+#define TONES_MAX			16
+
+/* Number of harmonics of the mains frequency to look at */
+#define TONES_HUM_HARMONICS	5
+
+/* Each harmonic has a second filter half way to the next, for the noise floor */
+#define TONES_HUM_LANES		(TONES_HUM_HARMONICS * 2)
+
+/* Length of each Goertzel block (200ms gives 5Hz resolution) */
+#define TONES_BLOCK_SECS	0.2
+
+/* Line-up tone must be within this many dB of the expected level */
+#define TONES_TOLERANCE		1.0f
+
+/* Hum is reported when the harmonics together are louder than this,
+   and this much louder than the noise floor between them */
+#define TONES_HUM_THRESHOLD	-90.0f
+#define TONES_HUM_MARGIN	10.0f
+
+
+typedef struct {
+	double samplerate;
+	unsigned int count;
+	unsigned int hum_count;		/* harmonics, then as many noise floor lanes */
+	double freq[TONES_MAX];
+	float expect[TONES_MAX];
+
+	/* Goertzel filter state, one lane per frequency */
+	double coeff[TONES_MAX];
+	double s1[TONES_MAX];
+	double s2[TONES_MAX];
+	double energy;
+	unsigned long pos, len;
+
+	/* Results of the last complete block, written by the process callback */
+	double power[TONES_MAX];
+	double total;
+	volatile unsigned int seq;
+
+	/* Reporting state, only used by the main thread */
+	unsigned int seen;
+	int state[TONES_MAX];
+	int hum_state;
+} tones_t;
+
+
+tones_t *tones_new( double samplerate );
+int tones_add_hum( tones_t *tones, double mains );
+int tones_add_lineup( tones_t *tones, double freq, float level );
+void tones_process( tones_t *tones, const float *in, unsigned int nframes );
+void tones_report( tones_t *tones, float bias, FILE *out );
+void tones_free( tones_t *tones );
+
+
+#endif
@@ -0,0 +1,120 @@
+/*
+
+	weighting.c
+	A, C and Z frequency weighting filters for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "weighting.h"
+
+
+/* Pole frequencies from IEC 61672-1 */
+#define F1	20.598997
+#define F2	107.65265
+#define F3	737.86223
+#define F4	12194.217
+
+
+weighting_t *weighting_new( char type, double samplerate )
+{
+	biquad_coeffs_t sections[3];
+	const double w1 = biquad_prewarp( F1, samplerate );
+	const double w2 = biquad_prewarp( F2, samplerate );
+	const double w3 = biquad_prewarp( F3, samplerate );
+	// At low sample rates the top pole would be above Nyquist
+	const double w4 = biquad_prewarp( fmin( F4, samplerate * 0.45 ), samplerate );
+	weighting_t *w;
+	int stages = 0, s;
+	double gain = 1.0;
+
+	switch (type) {
+		case 'A':
+			// s^4 / ((s+w1)^2 (s+w2) (s+w3) (s+w4)^2)
+			biquad_bilinear( 1.0, 0.0, 0.0, 1.0, 2.0*w1, w1*w1, samplerate, &sections[stages++] );
+			biquad_bilinear( 1.0, 0.0, 0.0, 1.0, w2+w3, w2*w3, samplerate, &sections[stages++] );
+			biquad_bilinear( 0.0, 0.0, 1.0, 1.0, 2.0*w4, w4*w4, samplerate, &sections[stages++] );
+			break;
+		case 'C':
+			// s^2 / ((s+w1)^2 (s+w4)^2)
+			biquad_bilinear( 1.0, 0.0, 0.0, 1.0, 2.0*w1, w1*w1, samplerate, &sections[stages++] );
+			biquad_bilinear( 0.0, 0.0, 1.0, 1.0, 2.0*w4, w4*w4, samplerate, &sections[stages++] );
+			break;
+		case 'Z':
+			break;
+		default:
+			return NULL;
+	}
+
+	// Normalise to 0dB at 1kHz
+	for (s=0; s < stages; s++) {
+		gain *= biquad_magnitude( &sections[s], 1000.0, samplerate );
+	}
+	if (stages) {
+		sections[0].b0 /= gain;
+		sections[0].b1 /= gain;
+		sections[0].b2 /= gain;
+	}
+
+	w = malloc( sizeof(weighting_t) );
+	if (w == NULL) return NULL;
+	w->type = type;
+	w->bank = biquad_bank_new( 1, stages );
+	if (w->bank == NULL) {
+		free( w );
+		return NULL;
+	}
+
+	for (s=0; s < stages; s++) {
+		biquad_bank_set( w->bank, 0, s, &sections[s] );
+	}
+
+	return w;
+}
+
+
+/* Called from the JACK process callback */
+void weighting_process( weighting_t *w, const float *in, float *out, unsigned int nframes )
+{
+	biquad_bank_t *bank = w->bank;
+	unsigned int i;
+
+	if (bank->stages == 0) {
+		if (out != in) memcpy( out, in, sizeof(float) * nframes );
+		return;
+	}
+
+	for (i=0; i < nframes; i++) {
+		bank->x[0] = in[i];
+		biquad_bank_tick( bank );
+		out[i] = bank->x[0];
+	}
+}
+
+
+void weighting_free( weighting_t *w )
+{
+	if (w == NULL) return;
+
+	biquad_bank_free( w->bank );
+	free( w );
+}
@@ -0,0 +1,41 @@
+/*
+
+	weighting.h
+	A, C and Z frequency weighting filters for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _WEIGHTING_H_
+#define _WEIGHTING_H_
+
+#include "biquad.h"
+
+
+typedef struct {
+	char type;
+	biquad_bank_t *bank;
+} weighting_t;
+
+
+/* type is 'A', 'C' or 'Z' (flat) */
+weighting_t *weighting_new( char type, double samplerate );
+void weighting_process( weighting_t *w, const float *in, float *out, unsigned int nframes );
+void weighting_free( weighting_t *w );
+
+
+#endif
@@ -0,0 +1,144 @@
+/*
+
+	window.c
+	Sliding window statistics for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "window.h"
+
+
+int parse_windows( const char *spec, float *secs, int max )
+{
+	int count = 0;
+	char *end;
+
+	while (*spec) {
+		if (count >= max) return -1;
+
+		secs[count] = strtof( spec, &end );
+		if (end == spec || secs[count] <= 0.0f) return -1;
+		count++;
+
+		spec = end;
+		if (*spec == ',') spec++;
+	}
+
+	return count ? count : -1;
+}
+
+
+mono_deque_t *mono_deque_new( unsigned int size, int want_max )
+{
+	mono_deque_t *dq;
+
+	if (size == 0) return NULL;
+
+	dq = calloc( 1, sizeof(mono_deque_t) );
+	if (dq == NULL) return NULL;
+
+	dq->size = size;
+	dq->want_max = want_max;
+	dq->seq = calloc( size, sizeof(unsigned long) );
+	dq->value = calloc( size, sizeof(double) );
+	if (dq->seq == NULL || dq->value == NULL) {
+		mono_deque_free( dq );
+		return NULL;
+	}
+
+	return dq;
+}
+
+
+/* Safe to call from the JACK process callback */
+void mono_deque_push( mono_deque_t *dq, double value )
+{
+	unsigned int tail;
+
+	// Drop values from the back which this one beats
+	while (dq->count) {
+		const double back = dq->value[ (dq->head + dq->count - 1) % dq->size ];
+		if (dq->want_max ? (back > value) : (back < value)) break;
+		dq->count--;
+	}
+
+	// Drop the front if it has slid out of the window
+	if (dq->count && dq->seq[dq->head] + dq->size <= dq->next) {
+		dq->head = (dq->head + 1) % dq->size;
+		dq->count--;
+	}
+
+	tail = (dq->head + dq->count) % dq->size;
+	dq->value[tail] = value;
+	dq->seq[tail] = dq->next++;
+	dq->count++;
+}
+
+
+double mono_deque_front( const mono_deque_t *dq )
+{
+	return dq->count ? dq->value[dq->head] : 0.0;
+}
+
+
+/*
+	Minimum (or maximum) of just the last n values pushed, n <= size.
+	The deque is sorted by age as well as by value, so this is a
+	binary search for the oldest entry still inside the shorter window.
+*/
+double mono_deque_last( const mono_deque_t *dq, unsigned int n )
+{
+	unsigned int lo = 0, hi;
+
+	if (dq->count == 0) return 0.0;
+	if (n == 0) n = 1;
+	if (n >= dq->next) return dq->value[dq->head];
+
+	hi = dq->count - 1;
+	while (lo < hi) {
+		const unsigned int mid = (lo + hi) / 2;
+		if (dq->seq[ (dq->head + mid) % dq->size ] < dq->next - n) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return dq->value[ (dq->head + lo) % dq->size ];
+}
+
+
+void mono_deque_reset( mono_deque_t *dq )
+{
+	dq->head = 0;
+	dq->count = 0;
+	dq->next = 0;
+}
+
+
+void mono_deque_free( mono_deque_t *dq )
+{
+	if (dq == NULL) return;
+
+	free( dq->seq );
+	free( dq->value );
+	free( dq );
+}
@@ -0,0 +1,63 @@
+/*
+
+	window.h
+	Sliding window statistics for Jack Meter
+	Copyright (C) 2005  Nicholas J. Humfrey
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _WINDOW_H_
+#define _WINDOW_H_
+
+
+/* Sliding windows move on this many frames at a time, whatever the JACK
+   period, so that changing the period doesn't change the windows */
+#define WINDOW_BLOCK	256
+
+
+/* Parse a comma separated list of window lengths in seconds,
+   returns the number of windows or -1 if it isn't valid */
+int parse_windows( const char *spec, float *secs, int max );
+
+
+/*
+	Monotonic deque: the minimum (or maximum) of the last 'size'
+	values pushed. Values that can never be the answer again are
+	dropped from the back as new ones arrive, so each push is O(1)
+	amortised and the answer is always at the front.
+*/
+typedef struct {
+	unsigned int size;
+	unsigned int head;
+	unsigned int count;
+	int want_max;
+
+	unsigned long next;
+	unsigned long *seq;
+	double *value;
+} mono_deque_t;
+
+
+mono_deque_t *mono_deque_new( unsigned int size, int want_max );
+void mono_deque_push( mono_deque_t *dq, double value );
+double mono_deque_front( const mono_deque_t *dq );
+double mono_deque_last( const mono_deque_t *dq, unsigned int n );
+void mono_deque_reset( mono_deque_t *dq );
+void mono_deque_free( mono_deque_t *dq );
+
+
+#endif